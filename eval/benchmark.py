@@ -0,0 +1,198 @@
+#!/usr/bin/python3.4
+
+# This file is part of PLTB.
+# Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+#
+# PLTB is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# PLTB is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+
+# Benchmark driver: runs a fixed range of models on fixed datasets with the
+# sequential implementation (1 process) and the MPI master/worker implementation
+# (2..N local processes), each with several numbers of PLL threads (-n). Every
+# case records the throughput (models per second of the whole run), the latency
+# percentiles of the model optimizations and the peak resident set size of the
+# largest process into a JSON report, optionally compared against a baseline
+# report of an earlier run (e.g. before a change, eval/res/benchmark-baseline.json
+# by make benchmark). Regressions fail the run iff the baseline was recorded on
+# the same host, numbers of other hosts are compared for information only.
+
+from __future__ import print_function
+
+import sys
+import os
+import math
+import json
+import time
+import socket
+import argparse
+import tempfile
+from subprocess import Popen, DEVNULL
+
+from lib.pltb_result_parser import parse_model_times_from_records
+
+DEFAULT_DATASETS = ['eval/res/datasets/testDatasets/10', 'eval/res/datasets/mrbayes/primates.phy']
+MODEL_COUNT = 203
+
+def parse_list(text):
+    return [int(v) for v in text.split(',')]
+
+# nearest-rank percentile of a sorted list
+def percentile(values, p):
+    if not values:
+        return None
+    rank = max(1, int(math.ceil(p / 100.0 * len(values))))
+    return values[rank - 1]
+
+def median(values):
+    ordered = sorted(values)
+    return ordered[len(ordered) // 2]
+
+# Runs pltb once. The peak RSS is the one of the largest process: wait4 reports
+# the maximum over the child and all descendants it waited for (mpirun's ranks).
+def run_case(args, dataset, processes, threads, records):
+    cmd = [args.pltb, '-f', dataset, '-n', str(threads), '-R', records] + args.pltb_args.split()
+    # pltb takes the whole model space by default, an explicit upper bound of 203 is refused
+    if args.lower > 0:
+        cmd += ['-l', str(args.lower)]
+    if args.upper < MODEL_COUNT:
+        cmd += ['-u', str(args.upper)]
+    if processes > 1:
+        cmd = args.mpirun.split() + ['-np', str(processes)] + cmd
+    begin = time.monotonic()
+    process = Popen(cmd, stdout=DEVNULL)
+    (_, status, usage) = os.wait4(process.pid, 0)
+    wall = time.monotonic() - begin
+    process.returncode = status
+    if status != 0:
+        raise RuntimeError('Failed (status ' + str(status) + '): ' + ' '.join(cmd))
+    # ru_maxrss in kilobytes (Linux) or bytes (OS X)
+    peak_rss_kb = usage.ru_maxrss // 1024 if sys.platform == 'darwin' else usage.ru_maxrss
+    return (wall, sorted(parse_model_times_from_records(records)), peak_rss_kb)
+
+def benchmark(args):
+    cases = []
+    (handle, records) = tempfile.mkstemp(suffix='.jsonl')
+    os.close(handle)
+    try:
+        for dataset in args.datasets:
+            for threads in args.threads:
+                for processes in args.processes:
+                    walls = []
+                    for _ in range(args.repeat):
+                        (wall, times, peak_rss_kb) = run_case(args, dataset, processes, threads, records)
+                        walls.append(wall)
+                    # the median run, the latencies & memory of the last one
+                    wall = median(walls)
+                    case = {
+                        'dataset': dataset,
+                        'models': [args.lower, args.upper],
+                        'processes': processes,
+                        'threads': threads,
+                        'wall_seconds': wall,
+                        'wall_seconds_all': walls,
+                        'evaluated_models': len(times),
+                        'models_per_second': len(times) / wall if wall > 0 else None,
+                        'latency_seconds': {
+                            'p50': percentile(times, 50),
+                            'p90': percentile(times, 90),
+                            'p99': percentile(times, 99),
+                            'max': times[-1] if times else None
+                        },
+                        'peak_rss_kb': peak_rss_kb
+                    }
+                    cases.append(case)
+                    print_case(case)
+    finally:
+        os.remove(records)
+    add_scaling(cases)
+    return {
+        'host': socket.gethostname(),
+        'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'command': ' '.join(sys.argv),
+        'cases': cases
+    }
+
+# strong scaling: speedup & efficiency relative to the smallest number of processes of the same dataset & threads
+def add_scaling(cases):
+    for case in cases:
+        group = [c for c in cases if c['dataset'] == case['dataset'] and c['threads'] == case['threads']]
+        reference = min(group, key=lambda c: c['processes'])
+        case['speedup'] = reference['wall_seconds'] / case['wall_seconds']
+        case['efficiency'] = case['speedup'] * reference['processes'] / case['processes']
+
+def case_key(case):
+    return (case['dataset'], tuple(case['models']), case['processes'], case['threads'])
+
+def print_case(case):
+    latency = case['latency_seconds']
+    print('%-45s np %2d  n %2d | %8.3f s | %8.2f models/s | p50 %7.4f p90 %7.4f p99 %7.4f s | %8d KB' % (
+        case['dataset'][-45:], case['processes'], case['threads'], case['wall_seconds'],
+        case['models_per_second'] or 0, latency['p50'] or 0, latency['p90'] or 0, latency['p99'] or 0,
+        case['peak_rss_kb']))
+
+# @return the number of cases slower than the baseline beyond the tolerance
+def compare(report, baseline, tolerance):
+    reference = dict((case_key(c), c) for c in baseline['cases'])
+    regressions = 0
+    print('Compared to the baseline of %s (%s):' % (baseline['host'], baseline['date']))
+    for case in report['cases']:
+        before = reference.get(case_key(case))
+        if before is None or not before['models_per_second'] or not case['models_per_second']:
+            print('%-45s np %2d  n %2d | no baseline' % (case['dataset'][-45:], case['processes'], case['threads']))
+            continue
+        change = case['models_per_second'] / before['models_per_second'] - 1
+        regressed = change < -tolerance
+        regressions += regressed
+        print('%-45s np %2d  n %2d | %8.2f -> %8.2f models/s (%+6.1f%%) | RSS %8d -> %8d KB%s' % (
+            case['dataset'][-45:], case['processes'], case['threads'],
+            before['models_per_second'], case['models_per_second'], 100 * change,
+            before['peak_rss_kb'], case['peak_rss_kb'], '  REGRESSION' if regressed else ''))
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmarks pltb over fixed datasets, processes & threads.')
+    parser.add_argument('--pltb', default='./pltb.out', help='the binary (default: ./pltb.out)')
+    parser.add_argument('--mpirun', default='mpirun', help='MPI launcher incl. options (default: mpirun)')
+    parser.add_argument('--datasets', nargs='+', default=DEFAULT_DATASETS, help='dataset files')
+    parser.add_argument('--lower', type=int, default=0, help='first model index (default: 0)')
+    parser.add_argument('--upper', type=int, default=MODEL_COUNT, help='model index bound, excluded (default: 203)')
+    parser.add_argument('--processes', type=parse_list, default=[1, 2, 4],
+                        help='comma separated numbers of processes, 1 => sequential (default: 1,2,4)')
+    parser.add_argument('--threads', type=parse_list, default=[1],
+                        help='comma separated numbers of PLL threads per process (-n, default: 1)')
+    parser.add_argument('--repeat', type=int, default=3, help='runs per case, the median counts (default: 3)')
+    parser.add_argument('--pltb-args', default='', help='further arguments passed to pltb')
+    parser.add_argument('--report', default='benchmark-report.json', help='report file (default: benchmark-report.json)')
+    parser.add_argument('--baseline', help='report of an earlier run to compare against')
+    parser.add_argument('--tolerance', type=float, default=0.05,
+                        help='throughput loss counted as regression (default: 0.05)')
+    args = parser.parse_args()
+
+    report = benchmark(args)
+    with open(args.report, 'w') as target:
+        json.dump(report, target, indent=2)
+    print('Report written to ' + args.report)
+
+    if args.baseline:
+        with open(args.baseline) as source:
+            baseline = json.load(source)
+        regressions = compare(report, baseline, args.tolerance)
+        if regressions > 0 and baseline['host'] != report['host']:
+            print('Warning: ' + str(regressions) + ' case(s) slower than the baseline of another host, ' +
+                  'record one on this host to judge them (make benchmark-baseline)')
+        elif regressions > 0:
+            print(str(regressions) + ' case(s) regressed')
+            sys.exit(1)
+
+if __name__ == '__main__':
+    main()
@@ -1,6 +1,7 @@
 #!/usr/bin/python3.4
 from lib.pltb_data import GTR_MODEL, Selector, TreeEntry
 from itertools import dropwhile
+import json
 import re
 
 class ParseError(Exception):
@@ -42,3 +43,51 @@ def parse_trees_from_result_file(pltb_result_file, requires_gtr = True):
         trees.insert(0, gtrEntry)
 
     return trees
+
+# Like parse_trees_from_result_file, but reads the tree records of a JSON Lines
+# records file (pltb -R) instead of the textual result file. The records of all
+# configurations share one file, the one of the given dataset, seed, kind of
+# base frequencies and rate heterogeneity is selected (None => any).
+def parse_trees_from_records(records_file, dataset = None, seed = None, base_freqs = None, requires_gtr = True,
+                             rate_het = None):
+    trees = []
+    with open(records_file) as source:
+        for line in source:
+            record = json.loads(line)
+            if record['type'] != 'tree' \
+                    or (dataset is not None and record['dataset'] != dataset) \
+                    or (seed is not None and record['seed'] != seed) \
+                    or (base_freqs is not None and record['base_freqs'] != base_freqs) \
+                    or (rate_het is not None and record.get('rate_het', 'gamma') != rate_het):
+                continue
+            # the criteria selecting the model, e.g. 'AIC AICc-S' or 'extra'
+            ics = list(map(Selector, record['criterion'].split(' ')))
+            trees.append(TreeEntry(record['model'], ics, record['newick']))
+
+    if not trees:
+        raise ParseError("No tree found in " + records_file)
+
+    if requires_gtr:
+        gtrEntry = next((t for t in trees if t.model == GTR_MODEL), None)
+
+        if not gtrEntry:
+            raise ParseError("No tree found for GTR in " + records_file)
+
+        trees.remove(gtrEntry)
+        trees.insert(0, gtrEntry)
+
+    return trees
+
+# Reads the optimization times (real, in seconds) of the models evaluated by a
+# run from its JSON Lines records file (pltb -R), one per model and configuration.
+# Journaled and cached models took no time and are left out. The refined record
+# of a screening contender supersedes its screening record (it covers both stages).
+def parse_model_times_from_records(records_file):
+    times = {}
+    with open(records_file) as source:
+        for line in source:
+            record = json.loads(line)
+            if record['type'] == 'model' and not record['preloaded']:
+                key = (record['dataset'], record['seed'], record['base_freqs'], record.get('rate_het'), record['model'])
+                times[key] = record['time_real']
+    return list(times.values())
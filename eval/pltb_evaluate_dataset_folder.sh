@@ -23,8 +23,8 @@
 
 function process {
 	# expect $1: pltb
-	# expect $2: dataset
-	# expect $3: result base path
+	# expect $2: dataset folder
+	# expect $3: result folder
 	hex_seeds=( "12345" "54321" "00000" "11111" "22222" "33333" "44444" "55555" "66666" "77777" "88888" "99999" "AAAAA" "BBBBB" "CCCCC" "DDDDD" "EEEEE" "FFFFF" );
 
 	# configuration for the cluster we used
@@ -32,17 +32,14 @@ function process {
 	threads_per_process=4
 	threads_for_search=47
 
-	for seed in ${hex_seeds[@]}; do
-		mpi_part="mpirun -np $processes"
-		pltb_param="-f $2 -n $threads_per_process -s $threads_for_search -r 0x$seed -g"
-		pltb_part="$1 $pltb_param"
-		cmd="$mpi_part $pltb_part > $3-0x$seed.result"
-		echo "$cmd"
-		eval $cmd
-		cmd="$mpi_part $pltb_part -b > $3-0x$seed-opt.result"
-		echo "$cmd"
-		eval $cmd
-	done
+	# all datasets with all seeds and both kinds of base frequencies in one run (a batch),
+	# one result file per dataset and configuration
+	seeds=$(printf "0x%s," "${hex_seeds[@]}")
+	mpi_part="mpirun -np $processes"
+	pltb_param="-f $2 -n $threads_per_process -s $threads_for_search -r ${seeds%,} -k empirical,optimized -g -o $3"
+	cmd="$mpi_part $1 $pltb_param"
+	echo "$cmd"
+	eval $cmd
 }
 
 pltb="./pltb.out"
@@ -50,11 +47,8 @@ pltb="./pltb.out"
 if [[ -f "$pltb" ]]; then
 	datFolder=$1
 	resFolder=$2
-	for datFile in $datFolder/*; do
-		datName=$(basename "$datFile")
-		echo "Processing $datFile -> $resFolder/$dataName";
-		process $pltb $datFile "$resFolder/$datName";
-	done;
+	echo "Processing $datFolder -> $resFolder";
+	process $pltb $datFolder $resFolder;
 else
 	echo "Error: Binary $pltb does not exist."
 fi
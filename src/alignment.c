@@ -0,0 +1,298 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pll/pll.h>
+
+#include "alignment.h"
+
+/**
+ * Collects the distinct characters of all sequences.
+ * @return the alphabet size or 0 iff there are too many characters for nibbles
+ */
+static uint32_t collect_alphabet( pllAlignmentData *data, unsigned char *alphabet )
+{
+	bool seen[256] = { false };
+	uint32_t size = 0;
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		for (int j = 0; j < data->sequenceLength; j++) {
+			unsigned char c = data->sequenceData[i][j];
+			if (seen[c]) continue;
+			if (size == ALIGNMENT_ALPHABET_SIZE) return 0;
+			seen[c] = true;
+			alphabet[size++] = c;
+		}
+	}
+	return size;
+}
+
+static size_t states_size( pltb_alignment_header_t *header )
+{
+	size_t row = header->alphabet_size ? (header->sequence_length + 1) / 2 : header->sequence_length;
+	return row * header->sequence_count;
+}
+
+void pack_alignment_data( pllAlignmentData *data, pltb_packed_alignment_t *packed )
+{
+	pltb_alignment_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.sequence_count  = (uint32_t)data->sequenceCount;
+	header.sequence_length = (uint32_t)data->sequenceLength;
+	header.original_length = (uint32_t)data->originalSeqLength;
+	header.alphabet_size   = collect_alphabet(data, header.alphabet);
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		header.labels_size += (uint32_t)strlen(data->sequenceLabels[i]) + 1;
+	}
+
+	size_t weights_size = sizeof(uint32_t) * header.sequence_length;
+	packed->size  = sizeof(header) + weights_size + header.labels_size + states_size(&header);
+	packed->bytes = calloc(packed->size, 1);
+
+	unsigned char *cursor = packed->bytes;
+	memcpy(cursor, &header, sizeof(header));
+	cursor += sizeof(header);
+
+	for (uint32_t j = 0; j < header.sequence_length; j++) {
+		uint32_t weight = data->siteWeights ? (uint32_t)data->siteWeights[j] : 1;
+		memcpy(cursor, &weight, sizeof(weight));
+		cursor += sizeof(weight);
+	}
+
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		size_t length = strlen(data->sequenceLabels[i]) + 1;
+		memcpy(cursor, data->sequenceLabels[i], length);
+		cursor += length;
+	}
+
+	if (header.alphabet_size == 0) {
+		for (int i = 1; i <= data->sequenceCount; i++) {
+			memcpy(cursor, data->sequenceData[i], header.sequence_length);
+			cursor += header.sequence_length;
+		}
+	} else {
+		unsigned char codes[256];
+		for (uint32_t k = 0; k < header.alphabet_size; k++) {
+			codes[header.alphabet[k]] = (unsigned char)k;
+		}
+		for (int i = 1; i <= data->sequenceCount; i++) {
+			for (uint32_t j = 0; j < header.sequence_length; j++) {
+				unsigned char code = codes[data->sequenceData[i][j]];
+				cursor[j / 2] |= (unsigned char)(j % 2 ? code << 4 : code);
+			}
+			cursor += (header.sequence_length + 1) / 2;
+		}
+	}
+	assert(cursor == packed->bytes + packed->size);
+}
+
+pllAlignmentData *unpack_alignment_data( unsigned char *bytes, size_t size )
+{
+	pltb_alignment_header_t header;
+	if (size < sizeof(header)) return NULL;
+	memcpy(&header, bytes, sizeof(header));
+	size_t weights_size = sizeof(uint32_t) * header.sequence_length;
+	if (header.alphabet_size > ALIGNMENT_ALPHABET_SIZE
+			|| size != sizeof(header) + weights_size + header.labels_size + states_size(&header)) {
+		return NULL;
+	}
+
+	pllAlignmentData *data = pllInitAlignmentData((int)header.sequence_count, (int)header.sequence_length);
+	data->originalSeqLength = (int)header.original_length;
+
+	unsigned char *cursor = bytes + sizeof(header);
+
+	free(data->siteWeights);
+	data->siteWeights = malloc(sizeof(int) * header.sequence_length);
+	for (uint32_t j = 0; j < header.sequence_length; j++) {
+		uint32_t weight;
+		memcpy(&weight, cursor, sizeof(weight));
+		data->siteWeights[j] = (int)weight;
+		cursor += sizeof(weight);
+	}
+
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		data->sequenceLabels[i] = strdup((char*)cursor);
+		cursor += strlen((char*)cursor) + 1;
+	}
+
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		if (header.alphabet_size == 0) {
+			memcpy(data->sequenceData[i], cursor, header.sequence_length);
+			cursor += header.sequence_length;
+		} else {
+			for (uint32_t j = 0; j < header.sequence_length; j++) {
+				unsigned code = (unsigned)(j % 2 ? cursor[j / 2] >> 4 : cursor[j / 2] & 0x0F);
+				data->sequenceData[i][j] = header.alphabet[code];
+			}
+			cursor += (header.sequence_length + 1) / 2;
+		}
+		data->sequenceData[i][header.sequence_length] = '\0';
+	}
+	return data;
+}
+
+void destroy_packed_alignment( pltb_packed_alignment_t *packed )
+{
+	free(packed->bytes);
+	packed->bytes = NULL;
+	packed->size  = 0;
+}
+
+pllAlignmentData *shrink_alignment_data( pllAlignmentData *data )
+{
+	pllAlignmentData *shape = pllInitAlignmentData(data->sequenceCount, 0);
+	shape->sequenceLength    = data->sequenceLength;
+	shape->originalSeqLength = data->originalSeqLength;
+	return shape;
+}
+
+/* FNV-1a over one site (column) of the MSA */
+static uint64_t hash_site( pllAlignmentData *data, int site )
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		hash ^= data->sequenceData[i][site];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool equal_sites( pllAlignmentData *data, int a, pllAlignmentData *patterns, int b )
+{
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		if (data->sequenceData[i][a] != patterns->sequenceData[i][b]) return false;
+	}
+	return true;
+}
+
+pllAlignmentData *compress_alignment_patterns( pllAlignmentData *data )
+{
+	/* open addressing, at most half full: slot => pattern + 1, 0 => empty */
+	size_t n_slots = 2;
+	while (n_slots < 2 * (size_t)data->sequenceLength) n_slots *= 2;
+	int *slots = calloc(n_slots, sizeof(int));
+
+	pllAlignmentData *patterns = pllInitAlignmentData(data->sequenceCount, data->sequenceLength);
+	free(patterns->siteWeights);
+	patterns->siteWeights = malloc(sizeof(int) * (size_t)(data->sequenceLength > 0 ? data->sequenceLength : 1));
+	int n_patterns = 0;
+
+	for (int j = 0; j < data->sequenceLength; j++) {
+		int    weight = data->siteWeights ? data->siteWeights[j] : 1;
+		size_t slot   = (size_t)hash_site(data, j) & (n_slots - 1);
+		while (slots[slot] != 0 && !equal_sites(data, j, patterns, slots[slot] - 1)) {
+			slot = (slot + 1) & (n_slots - 1);
+		}
+		if (slots[slot] != 0) {
+			patterns->siteWeights[slots[slot] - 1] += weight;
+			continue;
+		}
+		for (int i = 1; i <= data->sequenceCount; i++) {
+			patterns->sequenceData[i][n_patterns] = data->sequenceData[i][j];
+		}
+		patterns->siteWeights[n_patterns] = weight;
+		slots[slot] = ++n_patterns;
+	}
+	free(slots);
+
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		patterns->sequenceLabels[i] = strdup(data->sequenceLabels[i]);
+		patterns->sequenceData[i][n_patterns] = '\0';
+	}
+	patterns->sequenceLength    = n_patterns;
+	patterns->originalSeqLength = data->originalSeqLength;
+	return patterns;
+}
+
+int write_alignment_file( char *path, pltb_packed_alignment_t *packed, uint64_t fingerprint )
+{
+	pltb_alignment_file_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ALIGNMENT_FILE_MAGIC, sizeof(ALIGNMENT_FILE_MAGIC));
+	header.version     = ALIGNMENT_FILE_VERSION;
+	header.fingerprint = fingerprint;
+	header.packed_size = packed->size;
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		perror(path);
+		return 1;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(packed->bytes, 1, packed->size, file) == packed->size;
+	written = fclose(file) == 0 && written;
+	if (!written) {
+		perror(path);
+		unlink(path);
+		return 1;
+	}
+	return 0;
+}
+
+bool read_alignment_file_header( char *path, pltb_alignment_file_header_t *header )
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	bool found = fread(header, sizeof(*header), 1, file) == 1
+		&& memcmp(header->magic, ALIGNMENT_FILE_MAGIC, sizeof(ALIGNMENT_FILE_MAGIC)) == 0
+		&& header->version == ALIGNMENT_FILE_VERSION;
+	fclose(file);
+	return found;
+}
+
+pllAlignmentData *map_alignment_file( char *path )
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		perror(path);
+		return NULL;
+	}
+	struct stat info;
+	void *bytes = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(pltb_alignment_file_header_t)) {
+		bytes = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (bytes == MAP_FAILED) {
+		fprintf(stderr, "Can't map alignment file %s.\n", path);
+		return NULL;
+	}
+
+	pltb_alignment_file_header_t header;
+	pllAlignmentData *data = NULL;
+	memcpy(&header, bytes, sizeof(header));
+	if (memcmp(header.magic, ALIGNMENT_FILE_MAGIC, sizeof(ALIGNMENT_FILE_MAGIC)) == 0
+			&& header.version == ALIGNMENT_FILE_VERSION
+			&& header.packed_size == (uint64_t)info.st_size - sizeof(header)) {
+		data = unpack_alignment_data((unsigned char*)bytes + sizeof(header), (size_t)header.packed_size);
+	}
+	munmap(bytes, (size_t)info.st_size);
+	if (data == NULL) {
+		fprintf(stderr, "Malformed alignment file %s.\n", path);
+	}
+	return data;
+}
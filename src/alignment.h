@@ -0,0 +1,109 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ALIGNMENT_H
+#define ALIGNMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pll/pll.h>
+
+/* states of at most 16 distinct characters are packed as nibbles */
+#define ALIGNMENT_ALPHABET_SIZE 16
+
+#define ALIGNMENT_FILE_MAGIC "PLTBALN"
+#define ALIGNMENT_FILE_VERSION 1
+
+typedef struct {
+	uint32_t sequence_count;
+	uint32_t sequence_length;
+	uint32_t original_length;
+	/* 0 => one byte per state, otherwise number of alphabet entries used */
+	uint32_t alphabet_size;
+	uint32_t labels_size;
+	unsigned char alphabet[ALIGNMENT_ALPHABET_SIZE];
+} pltb_alignment_header_t;
+
+/* header, site weights, zero-terminated sequence labels, states */
+typedef struct {
+	unsigned char *bytes;
+	size_t size;
+} pltb_packed_alignment_t;
+
+/* binary alignment file: this header followed by the packed alignment (@see write_alignment_file) */
+typedef struct {
+	char     magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	/* content hash of the stored MSA (@see fingerprint_alignment) */
+	uint64_t fingerprint;
+	uint64_t packed_size;
+} pltb_alignment_file_header_t;
+
+/**
+ * Serializes the MSA into one compact, self-contained byte buffer.
+ * Don't forget to destroy the buffer after use.
+ * @param data The MSA to pack
+ * @param packed Destination of the buffer
+ */
+void pack_alignment_data( pllAlignmentData *data, pltb_packed_alignment_t *packed );
+
+/**
+ * Rebuilds an MSA from a buffer created by pack_alignment_data.
+ * Don't forget to destroy the data after use.
+ * @return The MSA or NULL iff the buffer is malformed
+ */
+pllAlignmentData *unpack_alignment_data( unsigned char *bytes, size_t size );
+
+void destroy_packed_alignment( pltb_packed_alignment_t *packed );
+
+/**
+ * Creates an MSA holding the dimensions of the given one only (no sequences, labels or weights).
+ * Sufficient for calculating information criteria once the instances are set up, but must not be
+ * passed to PLL. Don't forget to destroy the data after use.
+ */
+pllAlignmentData *shrink_alignment_data( pllAlignmentData *data );
+
+/**
+ * Creates an MSA holding the unique site patterns of the given one in order of their first occurrence,
+ * weighted by the summed weights of their sites, just like PLL compresses the MSA when committing partitions.
+ * Don't forget to destroy the data after use.
+ */
+pllAlignmentData *compress_alignment_patterns( pllAlignmentData *data );
+
+/**
+ * Writes a binary alignment file.
+ * @param fingerprint The content hash of the packed MSA
+ * @return 0 on success, 1 otherwise
+ */
+int write_alignment_file( char *path, pltb_packed_alignment_t *packed, uint64_t fingerprint );
+
+/**
+ * Reads the header of a binary alignment file.
+ * @return false iff the file is no binary alignment file (of this version)
+ */
+bool read_alignment_file_header( char *path, pltb_alignment_file_header_t *header );
+
+/**
+ * Maps a binary alignment file and rebuilds the MSA from it, no parsing involved.
+ * Don't forget to destroy the data after use.
+ * @return The MSA or NULL iff the file can't be mapped or is malformed
+ */
+pllAlignmentData *map_alignment_file( char *path );
+
+#endif
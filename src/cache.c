@@ -0,0 +1,97 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "cache.h"
+
+#define CACHE_MAGIC "PLTB-CACHE"
+#define CACHE_VERSION 1
+#define CACHE_PATH_LENGTH 4096
+#define CACHE_HOST_LENGTH 64
+
+static void cache_path( pltb_cache_t *cache, unsigned index, char *path )
+{
+	snprintf(path, CACHE_PATH_LENGTH, "%s/%016" PRIx64 "-%016" PRIx64 "-%03u", cache->dir,
+	         cache->alignment_fingerprint, cache->config_fingerprint,
+	         absolute_model_index(cache->model_space, index));
+}
+
+int init_cache( pltb_cache_t *cache, char *dir, uint64_t alignment_fingerprint, uint64_t config_fingerprint,
+		model_space_t *model_space )
+{
+	cache->dir = dir;
+	cache->alignment_fingerprint = alignment_fingerprint;
+	cache->config_fingerprint    = config_fingerprint;
+	cache->model_space           = model_space;
+	if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+		printf("Can't create cache directory %s.\n", dir);
+		return 1;
+	}
+	return 0;
+}
+
+bool lookup_cache( pltb_cache_t *cache, unsigned index, pltb_model_stat_t *stat )
+{
+	char path[CACHE_PATH_LENGTH];
+	cache_path(cache, index, path);
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		return false;
+	}
+	int version = 0;
+	bool found = fscanf(file, CACHE_MAGIC " %d %la %la %la", &version,
+	                    &stat->likelihood, &stat->time_cpu, &stat->time_real) == 4
+		&& version == CACHE_VERSION;
+	fclose(file);
+
+	stat->matrix_index = index;
+	return found;
+}
+
+void store_cache( pltb_cache_t *cache, pltb_model_stat_t *stat )
+{
+	char path[CACHE_PATH_LENGTH];
+	char temp[CACHE_PATH_LENGTH + CACHE_HOST_LENGTH + 32];
+	char host[CACHE_HOST_LENGTH] = "";
+	cache_path(cache, stat->matrix_index, path);
+
+	/* unique among all processes sharing the directory */
+	gethostname(host, sizeof(host) - 1);
+	snprintf(temp, sizeof(temp), "%s.%s.%ld.tmp", path, host, (long)getpid());
+
+	FILE *file = fopen(temp, "w");
+	if (file == NULL) {
+		return;
+	}
+	fprintf(file, "%s %d %a %a %a\n", CACHE_MAGIC, CACHE_VERSION,
+	        stat->likelihood, stat->time_cpu, stat->time_real);
+	bool written = fflush(file) == 0 && fsync(fileno(file)) == 0;
+	written = fclose(file) == 0 && written;
+	/* concurrent writers of the same model store equivalent results, the last one wins */
+	if (!written || rename(temp, path) != 0) {
+		unlink(temp);
+	}
+}
@@ -0,0 +1,56 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "models.h"
+#include "pltb.h"
+
+/**
+ * Persistent cache of model evaluations, one file per model named after the fingerprints
+ * of the alignment & configuration and the absolute matrix index. Files are published
+ * by an atomic rename, so any number of jobs may share one cache directory.
+ */
+typedef struct pltb_cache {
+	char *dir;
+	uint64_t alignment_fingerprint;
+	uint64_t config_fingerprint;
+	model_space_t *model_space;
+} pltb_cache_t;
+
+/**
+ * @return 0 on success, 1 iff the cache directory can't be created
+ */
+int init_cache( pltb_cache_t *cache, char *dir, uint64_t alignment_fingerprint, uint64_t config_fingerprint,
+		model_space_t *model_space );
+
+/**
+ * Looks up the likelihood & timings of a model. The ICs are left to calculate_model_ICs.
+ * @param index The relative index of the model
+ * @return true iff the model has been cached
+ */
+bool lookup_cache( pltb_cache_t *cache, unsigned index, pltb_model_stat_t *stat );
+
+/**
+ * Stores the likelihood & timings of an evaluated model (best effort).
+ */
+void store_cache( pltb_cache_t *cache, pltb_model_stat_t *stat );
+
+#endif
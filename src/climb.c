@@ -0,0 +1,134 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "climb.h"
+
+void init_climb( pltb_climb_t *climb, model_space_t *model_space )
+{
+	unsigned count = model_space->matrix_count;
+
+	climb->model_space = model_space;
+	climb->evaluated   = calloc(count, sizeof(bool));
+	climb->frontier    = malloc(sizeof(unsigned) * count);
+	climb->n_frontier  = 0;
+	climb->n_evaluated = 0;
+	climb->started     = false;
+
+	for (unsigned i = 0; i < count; i++) {
+		unsigned parents[MAX_PARENT_MODELS];
+		if (parent_models(model_space, i, parents) == 0) {
+			climb->frontier[climb->n_frontier++] = i;
+		}
+	}
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		climb->climbing[i] = false;
+	}
+}
+
+/* moves every climbing criterion to its best child or stops it, all children are evaluated */
+static void step_climb( pltb_climb_t *climb, pltb_model_stat_t *stats )
+{
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		if (!climb->climbing[i]) continue;
+
+		unsigned children[MAX_CHILD_MODELS];
+		unsigned n_children = child_models(climb->model_space, climb->current[i], children);
+		unsigned best = climb->current[i];
+		for (unsigned j = 0; j < n_children; j++) {
+			if (stats[children[j]].ic[i] < stats[best].ic[i]) {
+				best = children[j];
+			}
+		}
+		climb->climbing[i] = best != climb->current[i];
+		climb->current[i]  = best;
+	}
+}
+
+/* the unevaluated children of the climbing criteria, in model order */
+static void collect_frontier( pltb_climb_t *climb )
+{
+	unsigned count = climb->model_space->matrix_count;
+	bool     in_frontier[count];
+	memset(in_frontier, 0, sizeof(in_frontier));
+
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		if (!climb->climbing[i]) continue;
+
+		unsigned children[MAX_CHILD_MODELS];
+		unsigned n_children = child_models(climb->model_space, climb->current[i], children);
+		for (unsigned j = 0; j < n_children; j++) {
+			if (!climb->evaluated[children[j]]) {
+				in_frontier[children[j]] = true;
+			}
+		}
+	}
+	climb->n_frontier = 0;
+	for (unsigned i = 0; i < count; i++) {
+		if (in_frontier[i]) {
+			climb->frontier[climb->n_frontier++] = i;
+		}
+	}
+}
+
+bool advance_climb( pltb_climb_t *climb, pltb_model_stat_t *stats )
+{
+	for (unsigned i = 0; i < climb->n_frontier; i++) {
+		climb->evaluated[climb->frontier[i]] = true;
+	}
+	climb->n_evaluated += climb->n_frontier;
+
+	if (!climb->started) {
+		/* every criterion starts at its best root */
+		for (unsigned i = 0; i < IC_MAX && climb->n_frontier > 0; i++) {
+			climb->climbing[i] = true;
+			climb->current[i]  = climb->frontier[0];
+			for (unsigned j = 1; j < climb->n_frontier; j++) {
+				if (stats[climb->frontier[j]].ic[i] < stats[climb->current[i]].ic[i]) {
+					climb->current[i] = climb->frontier[j];
+				}
+			}
+		}
+		climb->started = true;
+	} else {
+		step_climb(climb, stats);
+	}
+
+	while (true) {
+		collect_frontier(climb);
+		if (climb->n_frontier > 0) return true;
+
+		/* the children are evaluated already (on behalf of other criteria) or there are none */
+		bool climbing = false;
+		for (unsigned i = 0; i < IC_MAX; i++) {
+			climbing = climbing || climb->climbing[i];
+		}
+		if (!climbing) return false;
+		step_climb(climb, stats);
+	}
+}
+
+void destroy_climb( pltb_climb_t *climb )
+{
+	free(climb->evaluated);
+	free(climb->frontier);
+	climb->evaluated  = NULL;
+	climb->frontier   = NULL;
+	climb->n_frontier = 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CLIMB_H
+#define CLIMB_H
+
+#include <stdbool.h>
+#include "models.h"
+#include "pltb.h"
+
+/**
+ * Greedy search of the symmetry lattice, an alternative to evaluating the whole model space.
+ * Starting at the roots of the model space (000000 for the default one), every information
+ * criterion moves to its best child as long as that child improves the criterion.
+ * The unevaluated children of all criteria still climbing form the next frontier,
+ * which is evaluated at once.
+ */
+typedef struct {
+	model_space_t *model_space;
+	/* per model: part of a frontier so far */
+	bool          *evaluated;
+	/* the model each criterion is at, false => stopped */
+	unsigned       current [IC_MAX];
+	bool           climbing[IC_MAX];
+	/* the (relative) models to evaluate next */
+	unsigned      *frontier;
+	unsigned       n_frontier;
+	unsigned       n_evaluated;
+	bool           started;
+} pltb_climb_t;
+
+/**
+ * Sets up the climb, the first frontier holds the roots of the model space.
+ * Don't forget to destroy the climb after use.
+ */
+void init_climb( pltb_climb_t *climb, model_space_t *model_space );
+
+/**
+ * Moves the criteria on, once the models of the frontier are evaluated.
+ * @param stats Per (relative) model, complete for the models of all frontiers so far
+ * @return false iff the climb is over, the next frontier otherwise
+ */
+bool advance_climb( pltb_climb_t *climb, pltb_model_stat_t *stats );
+
+void destroy_climb( pltb_climb_t *climb );
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "counters.h"
+
+static bool enabled = false;
+
+#ifdef __linux__
+
+/* the counters of one thread, -1 => not available */
+typedef struct {
+	int fds[COUNTER_MAX];
+} thread_counters_t;
+
+static pthread_key_t  counters_key;
+static pthread_once_t counters_once = PTHREAD_ONCE_INIT;
+
+/* per counter, 0 => not configured */
+static uint64_t raw_events[COUNTER_MAX];
+
+static void close_thread_counters(void *arg)
+{
+	thread_counters_t *counters = arg;
+	for (unsigned i = 0; i < COUNTER_MAX; i++) {
+		if (counters->fds[i] >= 0) {
+			close(counters->fds[i]);
+		}
+	}
+	free(counters);
+}
+
+static void create_counters_key(void)
+{
+	pthread_key_create(&counters_key, &close_thread_counters);
+}
+
+/* counts the calling thread in user space, scaled by the time it was scheduled (@see read_counter) */
+static int open_counter(pltb_counter_t counter)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size           = sizeof(attr);
+	attr.type           = PERF_TYPE_HARDWARE;
+	attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv     = 1;
+	switch (counter) {
+		case COUNTER_CYCLES:
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case COUNTER_INSTRUCTIONS:
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case COUNTER_LLC_REFERENCES:
+			attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+			break;
+		case COUNTER_LLC_MISSES:
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		default:
+			if (raw_events[counter] == 0) return -1;
+			attr.type   = PERF_TYPE_RAW;
+			attr.config = raw_events[counter];
+			break;
+	}
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static thread_counters_t *thread_counters(void)
+{
+	thread_counters_t *counters = pthread_getspecific(counters_key);
+	if (counters == NULL) {
+		counters = malloc(sizeof(thread_counters_t));
+		for (unsigned i = 0; i < COUNTER_MAX; i++) {
+			counters->fds[i] = open_counter(i);
+		}
+		pthread_setspecific(counters_key, counters);
+	}
+	return counters;
+}
+
+/* the count extrapolated to the whole time enabled, more counters than the PMU offers are multiplexed */
+static uint64_t read_counter(int fd)
+{
+	uint64_t values[3]; /* value, time enabled, time running */
+	if (read(fd, values, sizeof(values)) != (ssize_t)sizeof(values) || values[2] == 0) {
+		return 0;
+	}
+	if (values[1] == values[2]) {
+		return values[0];
+	}
+	return (uint64_t)((double)values[0] * (double)values[1] / (double)values[2]);
+}
+
+static uint64_t parse_raw_event(const char *name)
+{
+	const char *value = getenv(name);
+	return value != NULL ? strtoull(value, NULL, 0) : 0;
+}
+
+uint32_t enable_counters( void )
+{
+	raw_events[COUNTER_FP_SCALAR] = parse_raw_event("PLTB_FP_SCALAR_EVENT");
+	raw_events[COUNTER_FP_VECTOR] = parse_raw_event("PLTB_FP_VECTOR_EVENT");
+	pthread_once(&counters_once, &create_counters_key);
+
+	thread_counters_t *counters  = thread_counters();
+	uint32_t           available = 0;
+	for (unsigned i = 0; i < COUNTER_MAX; i++) {
+		if (counters->fds[i] >= 0) {
+			available |= 1u << i;
+		}
+	}
+	enabled = available != 0;
+	return available;
+}
+
+void sample_counters( pltb_counter_sample_t *sample )
+{
+	if (!enabled) return;
+
+	thread_counters_t *counters = thread_counters();
+	for (unsigned i = 0; i < COUNTER_MAX; i++) {
+		sample->values[i] = counters->fds[i] >= 0 ? read_counter(counters->fds[i]) : 0;
+	}
+}
+
+void add_counters_since( pltb_counter_sample_t *since, uint64_t *totals, uint32_t *available )
+{
+	if (!enabled) return;
+
+	thread_counters_t    *counters = thread_counters();
+	pltb_counter_sample_t now;
+	sample_counters(&now);
+	for (unsigned i = 0; i < COUNTER_MAX; i++) {
+		if (counters->fds[i] < 0) continue;
+		/* the extrapolation of multiplexed counters may go backwards a bit */
+		totals[i] += now.values[i] > since->values[i] ? now.values[i] - since->values[i] : 0;
+		*available |= 1u << i;
+	}
+}
+
+#else
+
+uint32_t enable_counters( void )
+{
+	return 0;
+}
+
+void sample_counters( pltb_counter_sample_t *sample )
+{
+	(void)sample;
+}
+
+void add_counters_since( pltb_counter_sample_t *since, uint64_t *totals, uint32_t *available )
+{
+	(void)since;
+	(void)totals;
+	(void)available;
+}
+
+#endif
+
+bool counters_enabled( void )
+{
+	return enabled;
+}
+
+const char *get_counter_name( pltb_counter_t counter )
+{
+	static const char *names[COUNTER_MAX] = { "cycles", "instructions", "llc_references", "llc_misses",
+	                                          "fp_scalar", "fp_vector" };
+	return names[counter];
+}
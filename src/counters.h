@@ -0,0 +1,66 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* hardware counters measured around the model optimizations & tree searches */
+typedef enum {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	/* last level cache */
+	COUNTER_LLC_REFERENCES,
+	COUNTER_LLC_MISSES,
+	/* model specific raw events, configured by PLTB_FP_SCALAR_EVENT & PLTB_FP_VECTOR_EVENT
+	 * (e.g. 0x03c7 & 0x3cc7 for FP_ARITH_INST_RETIRED on recent Intel cores), none by default */
+	COUNTER_FP_SCALAR,
+	COUNTER_FP_VECTOR,
+	COUNTER_MAX
+} pltb_counter_t;
+
+/* the counts of the calling thread at some point, scaled when the counters were multiplexed */
+typedef struct {
+	uint64_t values[COUNTER_MAX];
+} pltb_counter_sample_t;
+
+/**
+ * Enables the counters for the whole process, to be called before any other thread is started.
+ * Every thread opens its own counters on first use (following its own thread only, PLL's threads are
+ * not covered) and closes them on exit. Counters the system doesn't provide (containers, VMs,
+ * perf_event_paranoid) are left out.
+ * @return A bit per counter available to the calling thread, 0 => counting is disabled again
+ */
+uint32_t enable_counters( void );
+
+bool counters_enabled( void );
+
+/* samples the calling thread's counters, no-op unless enabled */
+void sample_counters( pltb_counter_sample_t *sample );
+
+/**
+ * Adds the counts of the calling thread since a sample.
+ * @param totals Per counter
+ * @param available A bit per counter, the ones counted are set
+ */
+void add_counters_since( pltb_counter_sample_t *since, uint64_t *totals, uint32_t *available );
+
+const char *get_counter_name( pltb_counter_t counter );
+
+#endif
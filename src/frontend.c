@@ -24,16 +24,24 @@
 #include <limits.h>
 #include <assert.h>
 #include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #ifndef MPI_MASTER_WORKER
 #define MPI_MASTER_WORKER 1
 #endif
 
 #include "pltb.h"
+#include "pltb_frontend.h"
+#include "sink.h"
+#include "counters.h"
 #include "models.h"
+#include "reselect.h"
 #include "debug.h"
 
 #include "sequential.h"
+#include "threaded.h"
 #if MPI_MASTER_WORKER
 	#include "mpi_masterworker.h"
 #endif
@@ -44,6 +52,12 @@
 	#define ERROR(fmt, ...) do { fprintf(stderr, fmt, ##__VA_ARGS__); } while(0)
 #endif
 
+/* maximum number of random seeds of a sweep */
+#define MAX_SEEDS 64
+
+/* IC units a screened model may trail a leader, well beyond the loose optimizations' error in practice */
+#define DEFAULT_SCREEN_MARGIN 10.0
+
 static long parse_long(char *str)
 {
 	errno = 0;
@@ -58,6 +72,19 @@ static long parse_long(char *str)
 	return val;
 }
 
+/* @return The value or -1 iff the string is no (non-negative) number */
+static double parse_double(char *str)
+{
+	errno = 0;
+	char *endptr;
+	double val = strtod(str, &endptr);
+
+	if (errno != 0 || *endptr != '\0' || endptr == str || !(val >= 0)) {
+		return -1;
+	}
+	return val;
+}
+
 static int parse_int(char *str)
 {
 	long val = parse_long(str);
@@ -68,13 +95,359 @@ static int parse_int(char *str)
 	}
 }
 
+/**
+ * Parses a comma separated list of values (the string is modified).
+ * @return The number of values or 0 iff a value is illegal or there are too many
+ */
+static unsigned parse_seeds(char *str, long *seeds)
+{
+	unsigned n_seeds = 0;
+	for (char *token = strtok(str, ","); token != NULL; token = strtok(NULL, ",")) {
+		if (n_seeds == MAX_SEEDS) {
+			return 0;
+		}
+		seeds[n_seeds] = parse_long(token);
+		if (seeds[n_seeds] < 0) {
+			return 0;
+		}
+		n_seeds++;
+	}
+	return n_seeds;
+}
+
+/**
+ * Parses a comma separated list of base frequency kinds (the string is modified).
+ * @return The number of kinds or 0 iff a kind is unknown or there are too many
+ */
+static unsigned parse_base_freq_kinds(char *str, pltb_base_freq_t *kinds)
+{
+	unsigned n_kinds = 0;
+	for (char *token = strtok(str, ","); token != NULL; token = strtok(NULL, ",")) {
+		if (n_kinds == 3) {
+			return 0;
+		}
+		if (strcmp(token, "empirical") == 0) {
+			kinds[n_kinds++] = EMPIRICAL;
+		} else if (strcmp(token, "equal") == 0) {
+			kinds[n_kinds++] = EQUAL;
+		} else if (strcmp(token, "optimized") == 0) {
+			kinds[n_kinds++] = OPTIMIZED;
+		} else {
+			return 0;
+		}
+	}
+	return n_kinds;
+}
+
+/**
+ * Parses a comma separated list of rate heterogeneity variants (the string is modified).
+ * @param invariant Set iff invariant sites are requested, which PLL doesn't provide
+ * @param uniform Set iff uniform rates (a single rate category) are requested, which PLL doesn't provide
+ * @return The number of variants or 0 iff a variant is unknown or there are too many
+ */
+static unsigned parse_rate_hets(char *str, pltb_rate_het_t *rate_hets, bool *invariant, bool *uniform)
+{
+	unsigned n_rate_hets = 0;
+	*invariant = false;
+	*uniform   = false;
+	for (char *token = strtok(str, ","); token != NULL; token = strtok(NULL, ",")) {
+		if (n_rate_hets == 2) {
+			return 0;
+		}
+		if (strcmp(token, "gamma") == 0) {
+			rate_hets[n_rate_hets++] = RATE_GAMMA;
+		} else if (strcmp(token, "flat-gamma") == 0) {
+			rate_hets[n_rate_hets++] = RATE_FLAT_GAMMA;
+		} else {
+			*invariant = strcmp(token, "invariant") == 0 || strcmp(token, "gamma+invariant") == 0;
+			*uniform   = strcmp(token, "none") == 0 || strcmp(token, "uniform") == 0;
+			return 0;
+		}
+	}
+	return n_rate_hets;
+}
+
+/* <prefix>-0x<seed>[-opt|-eq][-flat-gamma].result, the naming pattern of eval/pltb_evaluate_dataset_folder.sh */
+static char *output_file_name(char *prefix, pltb_config_t *config)
+{
+	char *suffix = config->base_freq_kind == OPTIMIZED ? "-opt" : config->base_freq_kind == EQUAL ? "-eq" : "";
+	char *rates  = config->rate_het == RATE_FLAT_GAMMA ? "-flat-gamma" : "";
+	unsigned long seed = (unsigned long)config->attr_model_eval.randomNumberSeed;
+	char *path = malloc(sizeof(char) * (unsigned long) snprintf(NULL, 0, "%s-0x%05lX%s%s.result", prefix, seed, suffix, rates) + 1);
+	sprintf(path, "%s-0x%05lX%s%s.result", prefix, seed, suffix, rates);
+	return path;
+}
+
+static char *join_path(char *dir, char *name)
+{
+	char *path = malloc(sizeof(char) * (strlen(dir) + strlen(name) + 2));
+	sprintf(path, "%s/%s", dir, name);
+	return path;
+}
+
+static int is_visible(const struct dirent *entry)
+{
+	return entry->d_name[0] != '.';
+}
+
+/**
+ * Collects the datasets of a batch: the regular files of a directory sorted by name, hidden ones skipped.
+ * @return The number of datasets, don't forget to free the names & the list after use
+ */
+static unsigned list_directory(char *dir, char ***files)
+{
+	struct dirent **entries;
+	int n_entries = scandir(dir, &entries, is_visible, alphasort);
+	unsigned n_files = 0;
+
+	*files = malloc(sizeof(char*) * (size_t)(n_entries > 0 ? n_entries : 1));
+	for (int i = 0; i < n_entries; i++) {
+		struct stat info;
+		char *path = join_path(dir, entries[i]->d_name);
+		if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) {
+			(*files)[n_files++] = path;
+		} else {
+			free(path);
+		}
+		free(entries[i]);
+	}
+	if (n_entries >= 0) {
+		free(entries);
+	}
+	return n_files;
+}
+
+/**
+ * Collects the datasets of a batch from a manifest: one file per line,
+ * empty lines and lines starting with # are skipped.
+ * @return The number of datasets, don't forget to free the names & the list after use
+ */
+static unsigned read_manifest(char *manifest, char ***files)
+{
+	unsigned n_files = 0;
+	*files = NULL;
+
+	FILE *f = fopen(manifest, "r");
+	if (f == NULL) {
+		return 0;
+	}
+	char   *line     = NULL;
+	size_t  capacity = 0;
+	ssize_t length;
+	while ((length = getline(&line, &capacity, f)) != -1) {
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+			line[--length] = '\0';
+		}
+		if (length == 0 || line[0] == '#') continue;
+		*files = realloc(*files, sizeof(char*) * (n_files + 1));
+		(*files)[n_files++] = strdup(line);
+	}
+	free(line);
+	fclose(f);
+	return n_files;
+}
+
+/**
+ * pltb convert: stores a dataset as binary alignment file, a single process without MPI.
+ * @param argv The arguments following the command
+ */
+static int convert(int argc, char **argv, char *program)
+{
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s convert datafile binaryfile\n", program);
+		return 1;
+	}
+	if (access(argv[0], R_OK) == -1) {
+		fprintf(stderr, "Illegal dataset file: %s\n", argv[0]);
+		return 1;
+	}
+	return convert_alignment_file(argv[0], argv[1]);
+}
+
+/* @return the number of criteria, 0 => unknown name */
+static unsigned parse_criteria(char *str, const pltb_criterion_t **criteria)
+{
+	unsigned n_criteria = 0;
+	for (char *token = strtok(str, ","); token != NULL; token = strtok(NULL, ",")) {
+		const pltb_criterion_t *criterion = find_criterion(token);
+		if (criterion == NULL || n_criteria == N_CRITERIA) {
+			return 0;
+		}
+		criteria[n_criteria++] = criterion;
+	}
+	return n_criteria;
+}
+
+/**
+ * Searches the trees of the models a recomputed criterion selects and the result file holds none of,
+ * under the seed & model variant of the run (@see configure_from_file_name).
+ */
+static void search_reselected_trees(char *path, pltb_stored_result_t *result, pllAlignmentData *data,
+		const pltb_criterion_t **criteria, unsigned n_criteria, double *values)
+{
+	pltb_config_t config;
+	configure_attr_defaults(&config);
+	configure_from_file_name(&config, path);
+
+	unsigned n = result->n_models;
+	unsigned searched[N_CRITERIA];
+	unsigned n_searched = 0;
+	for (unsigned c = 0; c < n_criteria; c++) {
+		unsigned best = select_stored_model(&values[c * n], n);
+		bool done = has_stored_tree(result, result->models[best]);
+		for (unsigned i = 0; i < n_searched; i++) {
+			done |= searched[i] == best;
+		}
+		char matrix[MODEL_MATRIX_REPRESENTATION_LENGTH];
+		if (done || !find_matrix_repr(result->models[best], matrix)) {
+			continue;
+		}
+		searched[n_searched++] = best;
+		char *newick = search_tree(matrix, data, &config, NULL, NULL, NULL);
+		fprint_reselected_tree(stdout, result->models[best], result, criteria, n_criteria, values, newick);
+		free(newick);
+	}
+}
+
+/**
+ * pltb reselect: recomputes information criteria from the likelihoods of earlier result files
+ * (or directories of them) without optimizing any model again, a single process without MPI.
+ * @param argv The command followed by its arguments
+ */
+static int reselect(int argc, char **argv, char *program)
+{
+	const pltb_criterion_t *criteria[N_CRITERIA];
+	unsigned n_criteria = 0;
+	char *datafile   = NULL;
+	bool  all_models = false;
+	bool  search     = false;
+	int   error      = 0;
+
+	while (1) {
+		static struct option long_options[] = {
+			{"criteria", required_argument, 0, 'i'},
+			{"data",     required_argument, 0, 'f'},
+			{"models",   no_argument,       0, 'a'},
+			{"search",   no_argument,       0, 'T'},
+			{0,          0,                 0, 0  }
+		};
+		int opt_index = 0;
+		int c = getopt_long(argc, argv, "aTi:f:", long_options, &opt_index);
+
+		if (c == -1) break;
+		if (c == 'i') {
+			n_criteria = parse_criteria(optarg, criteria);
+			if (n_criteria == 0) {
+				fprintf(stderr, "Illegal list of criteria (AIC,AICc-S,AICc-M,BIC-S,BIC-M,HQC-S,HQC-M)\n");
+				error = 1;
+			}
+		} else if (c == 'f') {
+			datafile = optarg;
+		} else if (c == 'a') {
+			all_models = true;
+		} else if (c == 'T') {
+			search = true;
+		} else {
+			error = 1;
+		}
+	}
+	if (search && datafile == NULL) {
+		fprintf(stderr, "Tree searches (-T) need the dataset (-f)\n");
+		error = 1;
+	}
+	if (datafile != NULL && access(datafile, R_OK) == -1) {
+		fprintf(stderr, "Illegal dataset file: %s\n", datafile);
+		error = 1;
+	}
+	if (error || optind >= argc) {
+		fprintf(stderr, "Usage: %s reselect [(-i|--criteria) name[,name...]] [(-f|--data) datafile] [(-a|--models)] [(-T|--search)] resultfile|directory...\n", program);
+		return 1;
+	}
+	if (n_criteria == 0) {
+		for (; n_criteria < N_CRITERIA; n_criteria++) {
+			criteria[n_criteria] = get_criterion(n_criteria);
+		}
+	}
+
+	/* exact sample sizes instead of the ones derived from the stored values,
+	 * the weights count the columns of binary alignments as well (@see convert) */
+	pllAlignmentData *data = NULL;
+	unsigned sites = 0, taxa = 0;
+	if (datafile != NULL) {
+		data = read_alignment_data(datafile);
+		if (data == NULL) {
+			fprintf(stderr, "Can't read alignment %s.\n", datafile);
+			return 1;
+		}
+		for (int j = 0; j < data->sequenceLength; j++) {
+			sites += data->siteWeights ? (unsigned)data->siteWeights[j] : 1;
+		}
+		taxa = (unsigned)data->sequenceCount;
+	}
+
+	for (int a = optind; a < argc; a++) {
+		struct stat info;
+		char **files;
+		unsigned n_files = 1;
+		if (stat(argv[a], &info) == 0 && S_ISDIR(info.st_mode)) {
+			n_files = list_directory(argv[a], &files);
+		} else {
+			files    = malloc(sizeof(char*));
+			files[0] = strdup(argv[a]);
+		}
+
+		for (unsigned i = 0; i < n_files; i++) {
+			pltb_stored_result_t result;
+			if (!read_stored_result(files[i], &result)) {
+				fprintf(stderr, "Illegal result file: %s\n", files[i]);
+				error = 1;
+				free(files[i]);
+				continue;
+			}
+			if (data != NULL) {
+				if (result.sites != sites || result.taxa != taxa) {
+					fprintf(stderr, "%s: %u sites & %u taxa derived, the dataset has %u & %u\n", files[i],
+							result.sites, result.taxa, sites, taxa);
+				}
+				result.sites = sites;
+				result.taxa  = taxa;
+			}
+			double *values  = malloc(sizeof(double) * n_criteria * result.n_models);
+			double *weights = malloc(sizeof(double) * n_criteria * result.n_models);
+			compute_criteria(&result, criteria, n_criteria, values, weights);
+			fprint_reselection(stdout, files[i], &result, criteria, n_criteria, values, weights, all_models);
+			if (search) {
+				search_reselected_trees(files[i], &result, data, criteria, n_criteria, values);
+			}
+			free(values);
+			free(weights);
+			destroy_stored_result(&result);
+			free(files[i]);
+		}
+		free(files);
+	}
+	if (data != NULL) {
+		pllAlignmentDataDestroy(data);
+	}
+	return error;
+}
+
 int main (int argc, char **argv)
 {
+	if (argc > 1 && strcmp(argv[1], "convert") == 0) {
+		return convert(argc - 2, argv + 2, argv[0]);
+	}
+	if (argc > 1 && strcmp(argv[1], "reselect") == 0) {
+		return reselect(argc - 1, argv + 1, argv[0]);
+	}
+
 #if MPI_MASTER_WORKER
 	int process_id;
 	int n_processes;
 
-	MPI_Init(&argc, &argv);
+	/* the master may evaluate models in a second thread, which never calls MPI */
+	int thread_level;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_level);
 	MPI_Comm_rank(MPI_COMM_WORLD, &process_id);
 	MPI_Comm_size(MPI_COMM_WORLD, &n_processes);
 #endif
@@ -90,9 +463,42 @@ int main (int argc, char **argv)
 	config.extra_models   = (unsigned*)&NO_EXTRA_MODEL;
 	config.n_extra_models = 0;
 	config.base_freq_kind = EMPIRICAL;
+	config.rate_het       = RATE_GAMMA;
+	config.warm_start     = false;
+	config.greedy_climb   = false;
+	config.screen_epsilon = 0;
+	config.screen_margin  = DEFAULT_SCREEN_MARGIN;
+	config.shared_alignment = false;
+	config.speculative_tree_search = false;
+	config.seed_tree_searches      = false;
+	config.master_evaluates = false;
+	config.eval_threads     = 1;
+	config.journal_file     = NULL;
+	config.cache_dir        = NULL;
+	config.output           = stdout;
+	config.output_file      = NULL;
+	config.sink             = NULL;
+	config.dataset_file     = NULL;
+	config.profile          = NULL;
+
+	/* sweep: every random seed with every kind of base frequencies & rate heterogeneity, one configuration each */
+	long             seeds[MAX_SEEDS] = { config.attr_model_eval.randomNumberSeed };
+	unsigned         n_seeds          = 1;
+	pltb_base_freq_t base_freq_kinds[3] = { EMPIRICAL };
+	unsigned         n_base_freq_kinds  = 1;
+	pltb_rate_het_t  rate_hets[2]       = { RATE_GAMMA };
+	unsigned         n_rate_hets        = 1;
+	char            *output_prefix      = NULL;
 
-	/* pltb target */
+	/* machine-readable records of all configurations */
+	char              *records_file   = NULL;
+	pltb_sink_format_t records_format = SINK_JSONL;
+	pltb_sink_t        sink;
+	bool               records_open   = false;
+
+	/* pltb target: a dataset file, or a directory or manifest of datasets evaluated as one batch */
 	char *datafile      = NULL;  /* illegal default => to be set */
+	char *manifest      = NULL;
 
 	/* model space config */
 	int  upper_bound    = 203;
@@ -106,6 +512,13 @@ int main (int argc, char **argv)
 
 	bool print_config   = false;
 	bool print_progress = false;
+	bool print_profile  = false;
+	bool count_hardware = false;
+	bool counting       = false; /* counters requested & available to this process */
+
+	/* durations of the phases of the run, this process' share (@see profile.h) */
+	pltb_profile_t profile;
+	init_profile(&profile);
 
 	while (1) {
 		static struct option long_options[] = {
@@ -119,15 +532,72 @@ int main (int argc, char **argv)
 			{"config",          no_argument,       0, 'c'},
 			{"progress",        no_argument,       0, 'p'},
 			{"with-gtr",        no_argument,       0, 'g'},
+			{"warm-start",      no_argument,       0, 'w'},
+			{"shared-alignment", no_argument,      0, 'a'},
+			{"speculative",     no_argument,       0, 't'},
+			{"seed-trees",      no_argument,       0, 'T'},
+			{"master-evaluates", no_argument,      0, 'm'},
+			{"eval-threads",    required_argument, 0, 'e'},
+			{"journal",         required_argument, 0, 'j'},
+			{"cache",           required_argument, 0, 'd'},
+			{"base-freqs",      required_argument, 0, 'k'},
+			{"rate-het",        required_argument, 0, 'v'},
+			{"output",          required_argument, 0, 'o'},
+			{"manifest",        required_argument, 0, 'F'},
+			{"greedy",          no_argument,       0, 'G'},
+			{"screen",          required_argument, 0, 'S'},
+			{"margin",          required_argument, 0, 'M'},
+			{"records",         required_argument, 0, 'R'},
+			{"csv",             no_argument,       0, 'C'},
+			{"profile",         no_argument,       0, 'P'},
+			{"counters",        no_argument,       0, 'H'},
 			{0,                 0,                 0, 0  }
 		};
 
-		c = getopt_long(argc, argv, "cpbgf:u:l:n:s:r:", long_options, &opt_index);
+		c = getopt_long(argc, argv, "cpPHbgwatTmGCf:u:l:n:s:r:e:j:d:k:v:o:F:S:M:R:", long_options, &opt_index);
 
 		if (c == -1) break;
 		switch (c) {
 			case 'b':
-				config.base_freq_kind = OPTIMIZED;
+				base_freq_kinds[0] = OPTIMIZED;
+				n_base_freq_kinds  = 1;
+				break;
+			case 'k': {
+				unsigned n_kinds = parse_base_freq_kinds(optarg, base_freq_kinds);
+				if (n_kinds == 0) {
+					ERROR("Illegal list of base frequencies (empirical,equal,optimized)\n");
+					error = 1;
+				} else {
+					n_base_freq_kinds = n_kinds;
+				}
+				break;
+			}
+			case 'v': {
+				bool invariant, uniform;
+				unsigned n = parse_rate_hets(optarg, rate_hets, &invariant, &uniform);
+				if (invariant) {
+					ERROR("Invariant sites (+I) are not supported by PLL\n");
+					error = 1;
+				} else if (uniform) {
+					ERROR("Uniform rates (a single rate category) are not supported by PLL, "
+					      "flat-gamma approximates them (alpha fixed at its maximum)\n");
+					error = 1;
+				} else if (n == 0) {
+					ERROR("Illegal list of rate heterogeneity variants (gamma,flat-gamma)\n");
+					error = 1;
+				} else {
+					n_rate_hets = n;
+				}
+				break;
+			}
+			case 'o':
+				output_prefix = optarg;
+				break;
+			case 'R':
+				records_file = optarg;
+				break;
+			case 'C':
+				records_format = SINK_CSV;
 				break;
 			case 'f':
 				if (access(optarg, R_OK) != -1) {
@@ -137,6 +607,14 @@ int main (int argc, char **argv)
 					error = 1;
 				}
 				break;
+			case 'F':
+				if (access(optarg, R_OK) != -1) {
+					manifest = optarg;
+				} else {
+					ERROR("Illegal manifest file: %s\n", optarg);
+					error = 1;
+				}
+				break;
 			case 'u':
 				upper_bound = parse_int(optarg);
 				if (upper_bound < 1 || upper_bound > 202) {
@@ -165,20 +643,80 @@ int main (int argc, char **argv)
 					error = 1;
 				}
 				break;
-			case 'r':
-				config.attr_model_eval.randomNumberSeed = parse_long(optarg);
-				config.attr_tree_search.randomNumberSeed = parse_long(optarg);
+			case 'e': {
+				int eval_threads = parse_int(optarg);
+				if (eval_threads < 1) {
+					ERROR("Illegal value for number of evaluation threads: %s\n", optarg);
+					error = 1;
+				} else {
+					config.eval_threads = (unsigned)eval_threads;
+				}
+				break;
+			}
+			case 'j':
+				config.journal_file = optarg;
+				break;
+			case 'd':
+				config.cache_dir = optarg;
+				break;
+			case 'r': {
+				unsigned n = parse_seeds(optarg, seeds);
+				if (n == 0) {
+					ERROR("Illegal list of random seeds (at most %d)\n", MAX_SEEDS);
+					error = 1;
+				} else {
+					n_seeds = n;
+				}
 				break;
+			}
 			case 'c':
 				print_config = true;
 				break;
 			case 'p':
 				print_progress = true;
 				break;
+			case 'P':
+				print_profile = true;
+				break;
+			case 'H':
+				count_hardware = true;
+				break;
 			case 'g':
 				config.n_extra_models = 1;
 				config.extra_models = (unsigned*)&EXTRA_GTR;
 				break;
+			case 'w':
+				config.warm_start = true;
+				break;
+			case 'G':
+				config.greedy_climb = true;
+				break;
+			case 'S':
+				config.screen_epsilon = parse_double(optarg);
+				if (config.screen_epsilon <= 0) {
+					ERROR("Illegal convergence threshold for screening: %s\n", optarg);
+					error = 1;
+				}
+				break;
+			case 'M':
+				config.screen_margin = parse_double(optarg);
+				if (config.screen_margin < 0) {
+					ERROR("Illegal margin for screening: %s\n", optarg);
+					error = 1;
+				}
+				break;
+			case 'a':
+				config.shared_alignment = true;
+				break;
+			case 't':
+				config.speculative_tree_search = true;
+				break;
+			case 'T':
+				config.seed_tree_searches = true;
+				break;
+			case 'm':
+				config.master_evaluates = true;
+				break;
 			case 0:
 				/* all long options return a value != 0 */
 				assert(false);
@@ -195,10 +733,39 @@ int main (int argc, char **argv)
 		break;
 	}
 
-	if (!error && !datafile) {
+	if (!error && !datafile && !manifest) {
 		ERROR("Missing required file argument\n");
 		error = 1;
 	}
+	if (!error && datafile && manifest) {
+		ERROR("Either a dataset or a manifest, not both\n");
+		error = 1;
+	}
+
+	/* the datasets, several ones form a batch sharing one pool of tasks */
+	char   **datafiles  = NULL;
+	unsigned n_datasets = 0;
+	struct stat datafile_info;
+	if (!error && manifest) {
+		n_datasets = read_manifest(manifest, &datafiles);
+	} else if (!error && stat(datafile, &datafile_info) == 0 && S_ISDIR(datafile_info.st_mode)) {
+		n_datasets = list_directory(datafile, &datafiles);
+	} else if (!error) {
+		datafiles    = malloc(sizeof(char*));
+		datafiles[0] = strdup(datafile);
+		n_datasets   = 1;
+	}
+	if (!error && n_datasets == 0) {
+		ERROR("No datasets in %s\n", manifest ? manifest : datafile);
+		error = 1;
+	}
+	for (unsigned i = 0; !error && i < n_datasets; i++) {
+		if (access(datafiles[i], R_OK) == -1) {
+			ERROR("Illegal dataset file: %s\n", datafiles[i]);
+			error = 1;
+		}
+	}
+	bool batch = n_datasets > 1;
 
 	if (!error) {
 		if (lower_bound >= upper_bound) {
@@ -207,6 +774,94 @@ int main (int argc, char **argv)
 		}
 	}
 
+	/* per dataset */
+	unsigned n_variants        = n_base_freq_kinds * n_rate_hets;
+	unsigned n_dataset_configs = n_seeds * n_variants;
+	unsigned n_configs = n_datasets * n_dataset_configs;
+	if (!error && batch && output_prefix == NULL) {
+		ERROR("A batch of datasets requires an output directory (-o)\n");
+		error = 1;
+	}
+	if (!error && n_configs > 1 && output_prefix == NULL) {
+		ERROR("Several configurations require an output prefix (-o)\n");
+		error = 1;
+	}
+	if (!error && n_configs > 1 && config.journal_file != NULL) {
+		ERROR("A journal covers a single configuration, use a cache directory (-d) instead\n");
+		error = 1;
+	}
+	if (!error && batch && config.shared_alignment) {
+		ERROR("A shared alignment covers a single dataset\n");
+		error = 1;
+	}
+
+#if MPI_MASTER_WORKER
+	bool writes_outputs = process_id == 0;
+#else
+	bool writes_outputs = true;
+#endif
+	if (!error && batch && writes_outputs && mkdir(output_prefix, 0777) != 0 && errno != EEXIST) {
+		perror(output_prefix);
+		error = 1;
+	}
+
+	/* one dataset after another, in the order of eval/pltb_evaluate_dataset_folder.sh each */
+	pltb_config_t *configs = malloc(sizeof(pltb_config_t) * (n_configs > 0 ? n_configs : 1));
+	unsigned       n_named = 0; /* configurations with an output file */
+	for (unsigned i = 0; !error && i < n_configs; i++) {
+		unsigned j = i % n_dataset_configs;
+		configs[i] = config;
+		configs[i].attr_model_eval.randomNumberSeed  = seeds[j / n_variants];
+		configs[i].attr_tree_search.randomNumberSeed = seeds[j / n_variants];
+		configs[i].base_freq_kind = base_freq_kinds[j % n_variants / n_rate_hets];
+		configs[i].rate_het       = rate_hets[j % n_rate_hets];
+		configs[i].output_file    = NULL;
+		configs[i].dataset_file   = datafiles[i / n_dataset_configs];
+		configs[i].profile        = print_profile || count_hardware ? &profile : NULL;
+		if (output_prefix == NULL) continue;
+
+		if (batch) {
+			/* <directory>/<dataset>-0x<seed>[-opt|-eq][-flat-gamma].result */
+			char *dataset = strrchr(datafiles[i / n_dataset_configs], '/');
+			char *prefix  = join_path(output_prefix, dataset != NULL ? dataset + 1 : datafiles[i / n_dataset_configs]);
+			configs[i].output_file = output_file_name(prefix, &configs[i]);
+			free(prefix);
+		} else {
+			configs[i].output_file = output_file_name(output_prefix, &configs[i]);
+		}
+		n_named++;
+
+		/* opened for appending while in use (@see open_output), start with an empty file */
+		if (writes_outputs) {
+			FILE *output = fopen(configs[i].output_file, "w");
+			if (output == NULL) {
+				perror(configs[i].output_file);
+				error = 1;
+			} else {
+				fclose(output);
+			}
+		}
+	}
+	/* before any thread is started, falls back to the plain run without counters */
+	if (!error && count_hardware) {
+		counting = enable_counters() != 0;
+		if (!counting) {
+			ERROR("Hardware counters unavailable (perf_event_open), continuing without\n");
+		}
+	}
+	/* the records are written by the master only, as they come in */
+	if (!error && records_file != NULL && writes_outputs) {
+		error = open_sink(&sink, records_file, records_format);
+		records_open = !error;
+		for (unsigned i = 0; records_open && i < n_configs; i++) {
+			configs[i].sink = &sink;
+		}
+	}
+#if MPI_MASTER_WORKER
+	/* only the master writes the output files */
+	MPI_Bcast(&error, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+
 	if(!error)
 	{
 #if MPI_MASTER_WORKER
@@ -215,26 +870,60 @@ int main (int argc, char **argv)
 		if (print_config) {
 #endif
 			DBG("Configuration\n");
-			DBG("\tDataset: %s\n", datafile);
-			DBG("\tRandom number seeds: %#lx/%#lx\n", config.attr_model_eval.randomNumberSeed, config.attr_tree_search.randomNumberSeed);
-			DBG("\tBase frequencies: ");
-			switch (config.base_freq_kind) {
-				case EMPIRICAL:
-					DBG("Empirical");
-					break;
-				case OPTIMIZED:
-					DBG("Optimized");
-					break;
-				case EQUAL:
-					DBG("Equal - not implemented yet");
-					break;
+			if (batch) {
+				DBG("\tDatasets: %u of %s\n", n_datasets, manifest ? manifest : datafile);
+			} else {
+				DBG("\tDataset: %s\n", datafiles[0]);
+			}
+			DBG("\tRandom number seeds:");
+			for (unsigned i = 0; i < n_seeds; i++) {
+				DBG(" %#lx", seeds[i]);
 			}
 			DBG("\n");
+			DBG("\tBase frequencies:");
+			for (unsigned i = 0; i < n_base_freq_kinds; i++) {
+				switch (base_freq_kinds[i]) {
+					case EMPIRICAL:
+						DBG(" Empirical");
+						break;
+					case OPTIMIZED:
+						DBG(" Optimized");
+						break;
+					case EQUAL:
+						DBG(" Equal");
+						break;
+				}
+			}
+			DBG("\n");
+			DBG("\tRate heterogeneity:");
+			for (unsigned i = 0; i < n_rate_hets; i++) {
+				DBG(" %s", rate_hets[i] == RATE_GAMMA ? "Gamma" : "Flat-gamma (~uniform)");
+			}
+			DBG("\n");
+			DBG("\tOutput: %s\n", output_prefix != NULL ? output_prefix : "Standard output");
+			DBG("\tRecords: %s%s\n", records_file != NULL ? records_file : "None",
+			    records_file == NULL ? "" : records_format == SINK_CSV ? " (CSV)" : " (JSON Lines)");
+			DBG("\tPhase breakdown: %s\n", print_profile ? "Yes" : "No");
+			DBG("\tHardware counters: %s\n", counting ? "Yes" : count_hardware ? "Unavailable" : "No");
+			DBG("\tWarm start from parent models: %s\n", config.warm_start ? "Yes" : "No");
+			DBG("\tGreedy climb through the models: %s\n", config.greedy_climb ? "Yes" : "No");
+			if (config.screen_epsilon > 0) {
+				DBG("\tScreening: epsilon %g, margin %g\n", config.screen_epsilon, config.screen_margin);
+			} else {
+				DBG("\tScreening: No\n");
+			}
+			DBG("\tTree searches seeded by the first ML tree: %s\n", config.seed_tree_searches ? "Yes" : "No");
 #if MPI_MASTER_WORKER
+			DBG("\tShared alignment per node: %s\n", config.shared_alignment ? "Yes" : "No");
+			DBG("\tSpeculative tree search: %s\n", config.speculative_tree_search ? "Yes" : "No");
+			DBG("\tMaster evaluates models: %s\n", config.master_evaluates ? "Yes" : "No");
 			DBG("\tNumber of processes: %d\n", n_processes);
 #endif
 			DBG("\tNumber of threads per process: %d\n", config.attr_model_eval.numberOfThreads);
 			DBG("\tNumber of threads for tree search: %d\n", config.attr_tree_search.numberOfThreads);
+			DBG("\tNumber of evaluation threads: %u\n", config.eval_threads);
+			DBG("\tJournal: %s\n", config.journal_file != NULL ? config.journal_file : "None");
+			DBG("\tCache directory: %s\n", config.cache_dir != NULL ? config.cache_dir : "None");
 #if MPI_MASTER_WORKER
 			if (n_processes > 1) {
 				DBG("\tImplementation: Parallel\n");
@@ -247,25 +936,101 @@ int main (int argc, char **argv)
 		// configure model space
 		model_space_t model_space;
 		init_range_model_space(&model_space, (unsigned)lower_bound, (unsigned)upper_bound);
+		TIME_STRUCT_INIT(run);
+		TIME_START(run);
 		// choose implementation
 #if MPI_MASTER_WORKER
 		if (n_processes > 1) {
-			// mpi master worker
-			error = run_master_worker(process_id, MPI_COMM_WORLD, datafile, &config, &model_space, print_progress);
+			// mpi master worker: all configurations share one pool of tasks
+			error = run_master_worker(process_id, MPI_COMM_WORLD, datafiles, n_datasets,
+			                          configs, n_configs, &model_space, print_progress);
 		} else
 #endif
 		{
-			// sequential
-			error = run_sequential(datafile, &config, &model_space);
+			/* the configurations of a dataset share its MSA & starting trees */
+			pltb_dataset_t dataset;
+			for (unsigned i = 0; !error && i < n_configs; i++) {
+				if (i % n_dataset_configs == 0) {
+					error = init_dataset(&dataset, datafiles[i / n_dataset_configs], &configs[i], n_dataset_configs);
+					if (error) break;
+				}
+				// one configuration after another
+				if (i > 0) {
+					// the model space is iterated once per run
+					destroy_model_space(&model_space);
+					init_range_model_space(&model_space, (unsigned)lower_bound, (unsigned)upper_bound);
+				}
+				open_output(&configs[i]);
+				if (config.eval_threads > 1) {
+					// several models at once
+					error = run_threaded(&dataset, dataset.start_trees[i % n_dataset_configs], &configs[i], &model_space);
+				} else {
+					// sequential
+					error = run_sequential(&dataset, dataset.start_trees[i % n_dataset_configs], &configs[i], &model_space);
+				}
+				close_output(&configs[i]);
+				if (error || (i + 1) % n_dataset_configs == 0) {
+					destroy_dataset(&dataset);
+				}
+			}
 		}
+		TIME_END(run);
 		if (error) {
 			ERROR("Execution ended with error code %d\n", error);
 		}
+
+		/* the variants of a dataset & seed are consecutive configurations */
+		for (unsigned i = 0; !error && writes_outputs && n_variants > 1 && i < n_configs; i += n_variants) {
+			fprint_joint_selection(stdout, &model_space, &configs[i], n_variants);
+			if (records_open) {
+				sink_joint_selection(&sink, &model_space, &configs[i], n_variants);
+			}
+		}
+
+		/* the breakdown covers all processes, reported by the master */
+#if MPI_MASTER_WORKER
+		unsigned        n_profiles = (unsigned)n_processes;
+		pltb_profile_t *profiles   = writes_outputs ? malloc(sizeof(pltb_profile_t) * n_profiles) : NULL;
+		if (print_profile || count_hardware) {
+			MPI_Gather(&profile, sizeof(pltb_profile_t), MPI_BYTE,
+			           profiles, sizeof(pltb_profile_t), MPI_BYTE, 0, MPI_COMM_WORLD);
+		}
+#else
+		unsigned        n_profiles = 1;
+		pltb_profile_t *profiles   = &profile;
+#endif
+		if (print_profile && writes_outputs) {
+			fprint_profile(stdout, profiles, n_profiles, TIME_REAL(run));
+			if (records_open) {
+				sink_profile(&sink, profiles, n_profiles);
+			}
+		}
+		if (counting && writes_outputs) {
+			fprint_counters(stdout, profiles, n_profiles);
+			if (records_open) {
+				sink_counters(&sink, profiles, n_profiles);
+			}
+		}
+#if MPI_MASTER_WORKER
+		free(profiles);
+#endif
 		destroy_model_space(&model_space);
 	} else {
 		error = 1;
-		ERROR("Usage: %s (-f|--data) datafile [-b|--opt-freq] [(-l|--lower-bound) incl_index] [(-u|--upper-bound) excl_index] [(-n|--npthreads) number] [(-s|--npthreads-tree) number] [(-r|--rseed) longvalue] [(-c|--config)] [(-p|--progress)] [(-g|--with-gtr)]\n", argv[0]);
+		ERROR("Usage: %s (-f|--data) datafile [-b|--opt-freq] [(-l|--lower-bound) incl_index] [(-u|--upper-bound) excl_index] [(-n|--npthreads) number] [(-s|--npthreads-tree) number] [(-r|--rseed) longvalue[,longvalue...]] [(-c|--config)] [(-p|--progress)] [(-P|--profile)] [(-H|--counters)] [(-g|--with-gtr)] [(-w|--warm-start)] [(-G|--greedy)] [(-S|--screen) epsilon] [(-M|--margin) units] [(-a|--shared-alignment)] [(-t|--speculative)] [(-T|--seed-trees)] [(-m|--master-evaluates)] [(-e|--eval-threads) number] [(-j|--journal) file] [(-d|--cache) directory] [(-k|--base-freqs) kinds] [(-v|--rate-het) variants] [(-o|--output) prefix] [(-R|--records) file] [(-C|--csv)] [(-F|--manifest) file]\n", argv[0]);
+	}
+
+	if (records_open) {
+		close_sink(&sink);
+	}
+	for (unsigned i = 0; i < n_named; i++) {
+		free(configs[i].output_file);
+	}
+	free(configs);
+	for (unsigned i = 0; i < n_datasets; i++) {
+		free(datafiles[i]);
 	}
+	free(datafiles);
 #if MPI_MASTER_WORKER
 	MPI_Finalize();
 #endif
@@ -68,26 +68,52 @@ static double calculateBIC(double maxLogLikelihood, unsigned freeParameters, int
 	return -2 * maxLogLikelihood + (double)freeParameters * log((double)numObservations);
 }
 
-void calculate_ICs( double* dst, pllAlignmentData *data, pllInstance *tree, unsigned parameter_count )
+void calculate_IC_batch( ic_penalty_t penalty, double sample_size, const double *likelihoods,
+		const double *params, unsigned n, double *dst )
+{
+	/* all penalties grow linearly in k, the AICc adds its correction term */
+	double slope;
+	switch (penalty) {
+		case PENALTY_BIC:
+			slope = log(sample_size);
+			break;
+		case PENALTY_HQC:
+			slope = 2 * log(log(sample_size));
+			break;
+		default:
+			assert(penalty == PENALTY_AIC || penalty == PENALTY_AICc);
+			slope = 2;
+	}
+	for (unsigned i = 0; i < n; i++) {
+		dst[i] = -2 * likelihoods[i] + slope * params[i];
+	}
+	if (penalty == PENALTY_AICc) {
+		for (unsigned i = 0; i < n; i++) {
+			dst[i] += (2 * params[i] * (params[i] + 1)) / (sample_size - params[i] - 1);
+		}
+	}
+}
+
+void calculate_ICs( double* dst, pllAlignmentData *data, double likelihood, unsigned parameter_count )
 {
 	for (unsigned i = 0; i < IC_MAX; i++) {
-		dst[i] = calculate_IC((IC)i, data, tree, parameter_count);
+		dst[i] = calculate_IC((IC)i, data, likelihood, parameter_count);
 	}
 }
 
-double calculate_IC( IC criterion, pllAlignmentData *data, pllInstance *tree, unsigned parameter_count )
+double calculate_IC( IC criterion, pllAlignmentData *data, double likelihood, unsigned parameter_count )
 {
 	switch(criterion) {
 		case AIC:
-			return calculateAIC(tree->likelihood, parameter_count);
+			return calculateAIC(likelihood, parameter_count);
 		case AICc_C:
-			return calculateAICc(tree->likelihood, parameter_count, (unsigned int)data->sequenceLength);
+			return calculateAICc(likelihood, parameter_count, (unsigned int)data->sequenceLength);
 		case AICc_RC:
-			return calculateAICc(tree->likelihood, parameter_count, (unsigned int)(data->sequenceLength * data->sequenceCount));
+			return calculateAICc(likelihood, parameter_count, (unsigned int)(data->sequenceLength * data->sequenceCount));
 		case BIC_C:
-			return calculateBIC(tree->likelihood, parameter_count, data->sequenceLength);
+			return calculateBIC(likelihood, parameter_count, data->sequenceLength);
 		case BIC_RC:
-			return calculateBIC(tree->likelihood, parameter_count,
+			return calculateBIC(likelihood, parameter_count,
 					data->sequenceLength * data->sequenceCount);
 		default:
 		case IC_MAX:
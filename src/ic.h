@@ -23,10 +23,20 @@
 /* all information criteria included */
 typedef enum { AIC, AICc_C, AICc_RC, BIC_C, BIC_RC, IC_MAX = BIC_RC + 1 } IC;
 
-/* calculate one specific crterion value */
-double calculate_IC( IC criterion, pllAlignmentData*, pllInstance*, unsigned );
+/* calculate one specific crterion value from a maximum log-likelihood */
+double calculate_IC( IC criterion, pllAlignmentData*, double likelihood, unsigned );
 
 /* calculate the values to all criteria available */
-void calculate_ICs( double* dst, pllAlignmentData*, pllInstance*, unsigned );
+void calculate_ICs( double* dst, pllAlignmentData*, double likelihood, unsigned );
+
+/* the penalty terms of the criteria: IC = -2 lnL + penalty(free parameters, sample size) */
+typedef enum { PENALTY_AIC, PENALTY_AICc, PENALTY_BIC, PENALTY_HQC } ic_penalty_t;
+
+/**
+ * Calculates one criterion for many models at once, for any sample size (@see reselect.h):
+ * dst[i] = -2 likelihoods[i] + penalty(params[i], sample_size)
+ */
+void calculate_IC_batch( ic_penalty_t penalty, double sample_size, const double *likelihoods,
+		const double *params, unsigned n, double *dst );
 
 #endif
@@ -0,0 +1,123 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <pll/pll.h>
+
+#include "journal.h"
+
+#define JOURNAL_MAGIC "PLTB-JOURNAL"
+#define JOURNAL_VERSION 1
+#define JOURNAL_LINE_LENGTH 512
+
+/**
+ * Parses a model record: absolute matrix index followed by likelihood, ICs and timings (hex floats).
+ */
+static bool parse_record( char *line, unsigned *matrix_index, pltb_model_stat_t *stat )
+{
+	int consumed = 0;
+	if (sscanf(line, "M %u %la%n", matrix_index, &stat->likelihood, &consumed) != 2) {
+		return false;
+	}
+	line += consumed;
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		if (sscanf(line, " %la%n", &stat->ic[i], &consumed) != 1) {
+			return false;
+		}
+		line += consumed;
+	}
+	return sscanf(line, " %la %la", &stat->time_cpu, &stat->time_real) == 2;
+}
+
+int open_journal( pltb_journal_t *journal, char *path, uint64_t alignment_fingerprint, uint64_t config_fingerprint,
+		model_space_t *model_space )
+{
+	char header[JOURNAL_LINE_LENGTH];
+	snprintf(header, sizeof(header), "%s %d %016" PRIx64 " %016" PRIx64 "\n",
+	         JOURNAL_MAGIC, JOURNAL_VERSION, alignment_fingerprint, config_fingerprint);
+
+	journal->model_space = model_space;
+	journal->file = fopen(path, "a+");
+	if (journal->file == NULL) {
+		printf("Can't open journal %s.\n", path);
+		return 1;
+	}
+	rewind(journal->file);
+	journal->stats       = malloc(sizeof(pltb_model_stat_t) * model_space->matrix_count);
+	journal->journaled   = calloc(model_space->matrix_count, sizeof(bool));
+	journal->n_journaled = 0;
+
+	char line[JOURNAL_LINE_LENGTH];
+	long valid_length = 0;
+	if (fgets(line, sizeof(line), journal->file) == NULL) {
+		/* new journal */
+		fputs(header, journal->file);
+	} else if (strcmp(line, header) != 0) {
+		printf("Journal %s belongs to another dataset or configuration.\n", path);
+		close_journal(journal);
+		return 1;
+	} else {
+		valid_length = ftell(journal->file);
+		while (fgets(line, sizeof(line), journal->file) != NULL) {
+			unsigned absolute;
+			unsigned relative;
+			pltb_model_stat_t stat;
+			/* a record without line break has been torn by a crash */
+			if (line[strlen(line) - 1] != '\n' || !parse_record(line, &absolute, &stat)) break;
+			valid_length = ftell(journal->file);
+			if (relative_model_index(model_space, absolute, &relative) && !journal->journaled[relative]) {
+				stat.matrix_index = relative;
+				journal->stats[relative]     = stat;
+				journal->journaled[relative] = true;
+				journal->n_journaled++;
+			}
+		}
+		fflush(journal->file);
+		if (ftruncate(fileno(journal->file), valid_length) != 0) {
+			printf("Can't repair journal %s.\n", path);
+			close_journal(journal);
+			return 1;
+		}
+		printf("Resuming from journal %s: %u model(s) evaluated already.\n", path, journal->n_journaled);
+	}
+	fflush(journal->file);
+	fsync(fileno(journal->file));
+	return 0;
+}
+
+void append_journal( pltb_journal_t *journal, pltb_model_stat_t *stat )
+{
+	fprintf(journal->file, "M %u %a", absolute_model_index(journal->model_space, stat->matrix_index), stat->likelihood);
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		fprintf(journal->file, " %a", stat->ic[i]);
+	}
+	fprintf(journal->file, " %a %a\n", stat->time_cpu, stat->time_real);
+	fflush(journal->file);
+	fsync(fileno(journal->file));
+}
+
+void close_journal( pltb_journal_t *journal )
+{
+	fclose(journal->file);
+	free(journal->stats);
+	free(journal->journaled);
+}
@@ -0,0 +1,56 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pll/pll.h>
+#include "models.h"
+#include "pltb.h"
+
+/**
+ * Append-only record of the evaluated models, one line per model.
+ * The header ties the journal to one dataset and configuration.
+ */
+typedef struct pltb_journal {
+	FILE *file;
+	model_space_t *model_space;
+	/* the models journaled by previous runs (indexed relatively) */
+	pltb_model_stat_t *stats;
+	bool *journaled;
+	unsigned n_journaled;
+} pltb_journal_t;
+
+/**
+ * Opens or creates the journal and loads the records of the models within the model space.
+ * An incomplete last record (of a crashed run) is dropped.
+ * @return 0 on success, 1 iff the journal can't be used (I/O error, other dataset or configuration)
+ */
+int open_journal( pltb_journal_t *journal, char *path, uint64_t alignment_fingerprint, uint64_t config_fingerprint,
+		model_space_t *model_space );
+
+/**
+ * Appends the statistics of an evaluated model and forces them to disk.
+ */
+void append_journal( pltb_journal_t *journal, pltb_model_stat_t *stat );
+
+void close_journal( pltb_journal_t *journal );
+
+#endif
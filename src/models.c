@@ -23,9 +23,6 @@
 
 #include "models.h"
 
-#define MAX_FREE_PARAMETER_COUNT 6
-#define MAX_MATRIX_INDEX 203
-
 const unsigned model_index_GTR = 202;
 
 static unsigned rate_matrix_count[] = {1, 31, 90, 65, 15, 1};
@@ -180,6 +177,90 @@ unsigned absolute_model_index( model_space_t *model_space, unsigned index )
 	return model_space->index_func(model_space->translator_context, index);
 }
 
+bool relative_model_index( model_space_t *model_space, unsigned absolute, unsigned *relative )
+{
+	for (unsigned i = 0; i < model_space->matrix_count; i++) {
+		if (absolute_model_index(model_space, i) == absolute) {
+			*relative = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* relabel the rate classes in order of their first occurrence, e.g. 022011 -> 011022 */
+static void normalize_matrix_digits( char *digits, unsigned length )
+{
+	char labels[MAX_FREE_PARAMETER_COUNT] = { 0 };
+	char next_label = '0';
+	for (unsigned i = 0; i < length; i++) {
+		unsigned rate_class = (unsigned)(digits[i] - '0');
+		if (!labels[rate_class]) {
+			labels[rate_class] = next_label++;
+		}
+		digits[i] = labels[rate_class];
+	}
+}
+
+static bool find_matrix_index( char *digits, unsigned *index )
+{
+	for (unsigned i = 0; i < MAX_MATRIX_INDEX; i++) {
+		if (strncmp(rate_matrices[i], digits, MAX_FREE_PARAMETER_COUNT) == 0) {
+			*index = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned parent_models( model_space_t *model_space, unsigned index, unsigned *parents )
+{
+	unsigned absolute = absolute_model_index(model_space, index);
+	unsigned K        = translate_index_to_K(absolute);
+	unsigned count    = 0;
+
+	for (unsigned a = 0; a < K; a++) {
+		for (unsigned b = a + 1; b < K; b++) {
+			/* merge rate class b into rate class a */
+			char digits[MAX_FREE_PARAMETER_COUNT];
+			for (unsigned i = 0; i < MAX_FREE_PARAMETER_COUNT; i++) {
+				char digit = rate_matrices[absolute][i];
+				digits[i] = digit == (char)('0' + b) ? (char)('0' + a) : digit;
+			}
+			normalize_matrix_digits(digits, MAX_FREE_PARAMETER_COUNT);
+
+			unsigned parent;
+			if (find_matrix_index(digits, &parent)
+					&& relative_model_index(model_space, parent, &parents[count])) {
+				count++;
+			}
+		}
+	}
+	assert(count <= MAX_PARENT_MODELS);
+	return count;
+}
+
+unsigned child_models( model_space_t *model_space, unsigned index, unsigned *children )
+{
+	unsigned K     = translate_index_to_K(absolute_model_index(model_space, index));
+	unsigned count = 0;
+
+	for (unsigned i = 0; i < model_space->matrix_count; i++) {
+		if (translate_index_to_K(absolute_model_index(model_space, i)) != K + 1) continue;
+
+		unsigned parents[MAX_PARENT_MODELS];
+		unsigned n_parents = parent_models(model_space, i, parents);
+		for (unsigned j = 0; j < n_parents; j++) {
+			if (parents[j] == index) {
+				children[count++] = i;
+				break;
+			}
+		}
+	}
+	assert(count <= MAX_CHILD_MODELS);
+	return count;
+}
+
 bool set_model( model_space_t *model_space, unsigned index )
 {
 	model_space->matrix_index = index;
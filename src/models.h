@@ -22,6 +22,14 @@
 
 #define MODEL_MATRIX_REPRESENTATION_LENGTH 12
 #define MODEL_MATRIX_REPRESENTATION_LENGTH_SHORT 7
+#define MAX_FREE_PARAMETER_COUNT 6
+/* number of models of the default model space */
+#define MAX_MATRIX_INDEX 203
+
+/* merging two of at most six rate classes */
+#define MAX_PARENT_MODELS 15
+/* splitting the single rate class of 000000 in two */
+#define MAX_CHILD_MODELS 31
 
 typedef unsigned (index_translator)( void *context, unsigned idx );
 
@@ -50,6 +58,32 @@ bool is_model_valid( model_space_t *model_space );
 
 unsigned absolute_model_index( model_space_t *model_space, unsigned index );
 
+/**
+ * Inverse of absolute_model_index.
+ * @return false iff the absolute index is not part of the model space
+ */
+bool relative_model_index( model_space_t *model_space, unsigned absolute, unsigned *relative );
+
+/**
+ * Collects the parents of a model in the symmetry lattice, i.e. the models with one
+ * rate class less which are obtained by merging two rate classes of the given model.
+ * Only parents contained in the model space are reported.
+ * @param index The (relative) index of the model
+ * @param parents Destination for the relative parent indices (MAX_PARENT_MODELS entries)
+ * @return The number of parents found
+ */
+unsigned parent_models( model_space_t *model_space, unsigned index, unsigned *parents );
+
+/**
+ * Collects the children of a model in the symmetry lattice, i.e. the models with one
+ * more rate class having the given model as a parent (@see parent_models).
+ * Only children contained in the model space are reported.
+ * @param index The (relative) index of the model
+ * @param children Destination for the relative child indices (MAX_CHILD_MODELS entries)
+ * @return The number of children found
+ */
+unsigned child_models( model_space_t *model_space, unsigned index, unsigned *children );
+
 bool set_model( model_space_t *model_space, unsigned index );
 
 bool next_model( model_space_t *model_space );
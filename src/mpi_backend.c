@@ -16,15 +16,21 @@
  * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include <assert.h>
+#include <limits.h>
+
+#include "alignment.h"
 #include "mpi_backend.h"
 
 void result_reduce(void *in, void *inout, int *len, MPI_Datatype *datatype) {
 	(void)datatype; // unused!
 	unsigned iterations = (unsigned int) *len;
-	while (iterations--) {
-		pltb_result_t *a = (pltb_result_t*)in;
-		pltb_result_t *b = (pltb_result_t*)inout;
+	pltb_result_t *a = (pltb_result_t*)in;
+	pltb_result_t *b = (pltb_result_t*)inout;
+	for (; iterations--; a++, b++) {
 		for (unsigned i = 0; i < IC_MAX; i++) {
 			if (a->ic[i] < b->ic[i]) {
 				b->ic[i] = a->ic[i];
@@ -35,12 +41,15 @@ void result_reduce(void *in, void *inout, int *len, MPI_Datatype *datatype) {
 }
 
 int init_MPI_Task_type(MPI_Datatype *task_type) {
-	static int          block_lengths[2] = { 1, 1 };
-	static MPI_Aint     offsets[2]       = { offsetof(pltb_task_t, matrix_index),
-	                                         offsetof(pltb_task_t, free_parameter_count)
+	static int          block_lengths[5] = { 1, 1, 1, 1, 1 };
+	static MPI_Aint     offsets[5]       = { offsetof(pltb_task_t, matrix_index),
+	                                         offsetof(pltb_task_t, free_parameter_count),
+	                                         offsetof(pltb_task_t, warm_start),
+	                                         offsetof(pltb_task_t, config_index),
+	                                         offsetof(pltb_task_t, refine)
 	                                       };
-	static MPI_Datatype member_types[2]  = { MPI_UNSIGNED, MPI_UNSIGNED };
-	return MPI_Type_struct(2, block_lengths, offsets, member_types, task_type);
+	static MPI_Datatype member_types[5]  = { MPI_UNSIGNED, MPI_UNSIGNED, MPI_UNSIGNED, MPI_UNSIGNED, MPI_UNSIGNED };
+	return MPI_Type_struct(5, block_lengths, offsets, member_types, task_type);
 }
 
 int init_MPI_Result_type(MPI_Datatype *result_type) {
@@ -68,3 +77,107 @@ int init_MPI_Model_stat_type( MPI_Datatype *result_type ) {
 	                                   };
 	return MPI_Type_struct(5, block_lengths, offsets, member_types, result_type);
 }
+
+int broadcast_string( char **str, int root, MPI_Comm comm )
+{
+	int process_id;
+	MPI_Comm_rank(comm, &process_id);
+
+	int length = process_id == root ? (int)strlen(*str) + 1 : 0;
+	MPI_Bcast(&length, 1, MPI_INT, root, comm);
+	if (process_id != root) {
+		*str = malloc(sizeof(char) * (size_t)length);
+	}
+	return MPI_Bcast(*str, length, MPI_CHAR, root, comm);
+}
+
+void broadcast_alignment_data( pllAlignmentData *data, pltb_packed_alignment_t *packed, int root, MPI_Comm comm )
+{
+	int process_id;
+	MPI_Comm_rank(comm, &process_id);
+
+	pltb_packed_alignment_t root_packed = { NULL, 0 };
+	if (process_id == root) {
+		pack_alignment_data(data, &root_packed);
+		packed = &root_packed;
+	}
+
+	unsigned long size = (unsigned long)packed->size;
+	MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG, root, comm);
+	assert(size <= INT_MAX);
+	if (process_id != root) {
+		packed->size  = (size_t)size;
+		packed->bytes = malloc(packed->size);
+	}
+	MPI_Bcast(packed->bytes, (int)size, MPI_BYTE, root, comm);
+
+	if (process_id == root) {
+		destroy_packed_alignment(&root_packed);
+	}
+}
+
+int init_shared_alignment( pltb_shared_alignment_t *shared, pllAlignmentData *data, int root, MPI_Comm comm )
+{
+#if MPI_VERSION >= 3
+	int process_id;
+	MPI_Comm_rank(comm, &process_id);
+
+	/* the root process is the leader (rank 0) of its node and among all leaders */
+	int key = process_id == root ? 0 : 1;
+	MPI_Comm node_comm;
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, key, MPI_INFO_NULL, &node_comm);
+	int node_rank;
+	MPI_Comm_rank(node_comm, &node_rank);
+	MPI_Comm leader_comm;
+	MPI_Comm_split(comm, node_rank == 0 ? 0 : MPI_UNDEFINED, key, &leader_comm);
+
+	/* PLL compresses the MSA to the same patterns when committing the partitions */
+	pltb_packed_alignment_t packed = { NULL, 0 };
+	if (process_id == root) {
+		pllAlignmentData *patterns = compress_alignment_patterns(data);
+		pack_alignment_data(patterns, &packed);
+		pllAlignmentDataDestroy(patterns);
+	}
+	unsigned long size = (unsigned long)packed.size;
+	MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG, root, comm);
+	assert(size <= INT_MAX);
+
+	/* the node leader allocates the whole window, the others map it */
+	MPI_Win_allocate_shared(node_rank == 0 ? (MPI_Aint)size : 0, 1, MPI_INFO_NULL, node_comm,
+	                        &shared->bytes, &shared->win);
+	if (node_rank != 0) {
+		MPI_Aint window_size;
+		int displacement_unit;
+		MPI_Win_shared_query(shared->win, 0, &window_size, &displacement_unit, &shared->bytes);
+	}
+	shared->size = (size_t)size;
+
+	if (node_rank == 0) {
+		if (process_id == root) {
+			memcpy(shared->bytes, packed.bytes, packed.size);
+		}
+		MPI_Bcast(shared->bytes, (int)size, MPI_BYTE, 0, leader_comm);
+		MPI_Comm_free(&leader_comm);
+	}
+	/* make the leader's writes visible on the whole node */
+	MPI_Win_fence(0, shared->win);
+
+	MPI_Comm_free(&node_comm);
+	if (process_id == root) {
+		destroy_packed_alignment(&packed);
+	}
+	return MPI_SUCCESS;
+#else
+	(void)shared; (void)data; (void)root; (void)comm;
+	return MPI_ERR_OTHER;
+#endif
+}
+
+void destroy_shared_alignment( pltb_shared_alignment_t *shared )
+{
+#if MPI_VERSION >= 3
+	MPI_Win_free(&shared->win);
+#endif
+	shared->bytes = NULL;
+	shared->size  = 0;
+}
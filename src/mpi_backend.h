@@ -21,10 +21,24 @@
 #include <mpi.h>
 
 #include "pltb.h"
+#include "alignment.h"
+
+/* read-only packed site patterns (@see pack_alignment_data) mapped by all processes of a node */
+typedef struct {
+    MPI_Win win;
+    unsigned char *bytes;
+    size_t size;
+} pltb_shared_alignment_t;
 
 typedef struct {
     unsigned matrix_index;
     unsigned free_parameter_count;
+    /* != 0 => a warm start state follows the task */
+    unsigned warm_start;
+    /* configuration of the sweep the task belongs to */
+    unsigned config_index;
+    /* != 0 => re-optimize a contender of a screening at full precision */
+    unsigned refine;
 } pltb_task_t;
 
 void result_reduce( void*, void*, int*, MPI_Datatype* );
@@ -33,4 +47,29 @@ int init_MPI_Task_type( MPI_Datatype* );
 int init_MPI_Result_type( MPI_Datatype* );
 int init_MPI_Model_stat_type( MPI_Datatype* result_type );
 
+/**
+ * Broadcasts a zero-terminated string of the root process.
+ * The string is allocated on all other processes, don't forget to free it after use.
+ */
+int broadcast_string( char **str, int root, MPI_Comm comm );
+
+/**
+ * Distributes the MSA parsed by the root process in its packed representation (@see pack_alignment_data).
+ * @param data The MSA on the root process, ignored on all other processes
+ * @param packed Receives the packed MSA on all but the root process, don't forget to destroy it after use
+ */
+void broadcast_alignment_data( pllAlignmentData *data, pltb_packed_alignment_t *packed, int root, MPI_Comm comm );
+
+/**
+ * Distributes the site patterns of the MSA parsed by the root process (@see compress_alignment_patterns)
+ * into one MPI-3 shared memory window per node. Only one process per node receives the data, all others
+ * map the node's copy. Collective operation, don't forget to destroy the shared alignment after use
+ * (collective as well).
+ * @param data The MSA on the root process, ignored on all other processes
+ * @return MPI_SUCCESS or an error code iff shared memory windows are not supported
+ */
+int init_shared_alignment( pltb_shared_alignment_t *shared, pllAlignmentData *data, int root, MPI_Comm comm );
+
+void destroy_shared_alignment( pltb_shared_alignment_t *shared );
+
 #endif
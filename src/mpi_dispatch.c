@@ -0,0 +1,218 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "scheduler.h"
+
+#include "mpi_dispatch.h"
+
+/* chunks of tasks a worker holds: the one it evaluates and the ones queued ahead */
+#define PREFETCH_CHUNKS 2
+
+/* tasks sent to a worker in one message, followed by the warm start states of its tasks */
+typedef struct {
+	pltb_task_t tasks   [MAX_CHUNK_SIZE];  /* send buffer */
+	unsigned    ids     [MAX_CHUNK_SIZE];
+	/* the chunk itself, the warm start state per task */
+	MPI_Request requests[MAX_CHUNK_SIZE + 1];
+	unsigned    size;
+	unsigned    n_finished;
+} chunk_t;
+
+/* a worker: the chunk it evaluates and the ones queued ahead (ring buffer) */
+struct worker_slot {
+	chunk_t           chunks[PREFETCH_CHUNKS];
+	unsigned          first;
+	unsigned          n_chunks;
+	/* receive buffer of the next result, posted as long as chunks are left */
+	pltb_model_stat_t reply;
+	/* a speculative tree search, handed to idle workers only */
+	bool              searching;
+	unsigned          tree_task;
+	pltb_task_t       tree_buffer;
+	MPI_Request       tree_request;
+};
+
+void init_dispatcher( pltb_dispatcher_t *dispatcher, int n_workers, MPI_Comm comm,
+		MPI_Datatype task_type, MPI_Datatype stat_type )
+{
+	dispatcher->n_workers   = n_workers;
+	dispatcher->comm        = comm;
+	dispatcher->task_type   = task_type;
+	dispatcher->stat_type   = stat_type;
+	dispatcher->slots       = calloc((size_t)n_workers, sizeof(struct worker_slot));
+	dispatcher->replies     = malloc(sizeof(MPI_Request) * (size_t)n_workers);
+	dispatcher->replied     = malloc(sizeof(int) * (size_t)n_workers);
+	dispatcher->n_searching = 0;
+	for (int slot = 0; slot < n_workers; slot++) {
+		struct worker_slot *worker = &dispatcher->slots[slot];
+		for (unsigned c = 0; c < PREFETCH_CHUNKS; c++) {
+			for (unsigned r = 0; r <= MAX_CHUNK_SIZE; r++) {
+				worker->chunks[c].requests[r] = MPI_REQUEST_NULL;
+			}
+		}
+		worker->tree_request      = MPI_REQUEST_NULL;
+		dispatcher->replies[slot] = MPI_REQUEST_NULL;
+	}
+}
+
+void destroy_dispatcher( pltb_dispatcher_t *dispatcher )
+{
+	/* the chunks are done with, their sends completed with the results */
+	for (int slot = 0; slot < dispatcher->n_workers; slot++) {
+		MPI_Wait(&dispatcher->slots[slot].tree_request, MPI_STATUS_IGNORE);
+	}
+	free(dispatcher->slots);
+	free(dispatcher->replies);
+	free(dispatcher->replied);
+	memset(dispatcher, 0, sizeof(pltb_dispatcher_t));
+}
+
+int select_worker( pltb_dispatcher_t *dispatcher, unsigned *worker_datasets, unsigned d )
+{
+	struct worker_slot *workers = dispatcher->slots;
+	int best = -1;
+	for (int slot = 0; slot < dispatcher->n_workers; slot++) {
+		if (workers[slot].searching || workers[slot].n_chunks == PREFETCH_CHUNKS) continue;
+		if (workers[slot].n_chunks > 0 && worker_datasets[slot] != d) continue;
+		if (best < 0 || workers[slot].n_chunks < workers[best].n_chunks) {
+			best = slot;
+		}
+	}
+	return best;
+}
+
+int idle_worker( pltb_dispatcher_t *dispatcher )
+{
+	for (int slot = 0; slot < dispatcher->n_workers; slot++) {
+		if (!dispatcher->slots[slot].searching && dispatcher->slots[slot].n_chunks == 0) return slot;
+	}
+	return -1;
+}
+
+void send_chunk( pltb_dispatcher_t *dispatcher, int slot, pltb_task_t *tasks, unsigned *ids, unsigned size,
+		double **warm_states, unsigned warm_length )
+{
+	int                 worker_id = slot + 1;
+	struct worker_slot *worker    = &dispatcher->slots[slot];
+	chunk_t            *chunk     = &worker->chunks[(worker->first + worker->n_chunks) % PREFETCH_CHUNKS];
+
+	memcpy(chunk->tasks, tasks, sizeof(pltb_task_t) * size);
+	memcpy(chunk->ids, ids, sizeof(unsigned) * size);
+	chunk->size       = size;
+	chunk->n_finished = 0;
+
+	/* the warm start states follow the chunk in the order of its tasks */
+	MPI_Isend(chunk->tasks, (int)size, dispatcher->task_type, worker_id,
+	          TASK_TAG, dispatcher->comm, &chunk->requests[0]);
+	for (unsigned j = 0; j < size; j++) {
+		if (tasks[j].warm_start) {
+			MPI_Isend(warm_states[j], (int)warm_length, MPI_DOUBLE, worker_id,
+			          WARM_TAG, dispatcher->comm, &chunk->requests[j + 1]);
+		}
+	}
+	if (worker->n_chunks++ == 0) {
+		MPI_Irecv(&worker->reply, 1, dispatcher->stat_type, worker_id, DONE_TAG, dispatcher->comm,
+		          &dispatcher->replies[slot]);
+	}
+}
+
+void send_tree_search( pltb_dispatcher_t *dispatcher, int slot, unsigned id, unsigned matrix_index,
+		unsigned config_index )
+{
+	struct worker_slot *worker = &dispatcher->slots[slot];
+
+	/* the buffer of the previous search is free once its send completed */
+	MPI_Wait(&worker->tree_request, MPI_STATUS_IGNORE);
+	memset(&worker->tree_buffer, 0, sizeof(pltb_task_t));
+	worker->tree_buffer.matrix_index = matrix_index;
+	worker->tree_buffer.config_index = config_index;
+	worker->tree_task = id;
+	worker->searching = true;
+	dispatcher->n_searching++;
+
+	MPI_Isend(&worker->tree_buffer, 1, dispatcher->task_type, slot + 1,
+	          TREE_TAG, dispatcher->comm, &worker->tree_request);
+}
+
+int collect_results( pltb_dispatcher_t *dispatcher, bool block )
+{
+	/* the posted receives complete in any order */
+	int n_replies;
+	if (block) {
+		MPI_Waitsome(dispatcher->n_workers, dispatcher->replies, &n_replies, dispatcher->replied, MPI_STATUSES_IGNORE);
+	} else {
+		MPI_Testsome(dispatcher->n_workers, dispatcher->replies, &n_replies, dispatcher->replied, MPI_STATUSES_IGNORE);
+	}
+	return n_replies == MPI_UNDEFINED ? 0 : n_replies;
+}
+
+unsigned result_task( pltb_dispatcher_t *dispatcher, int r )
+{
+	struct worker_slot *worker = &dispatcher->slots[dispatcher->replied[r]];
+	chunk_t            *chunk  = &worker->chunks[worker->first];
+	return chunk->ids[chunk->n_finished];
+}
+
+void receive_result( pltb_dispatcher_t *dispatcher, int r, pltb_model_stat_t *stat,
+		double *warm_state, unsigned warm_length )
+{
+	/* the results of a worker come in the order of its tasks */
+	int                 slot      = dispatcher->replied[r];
+	int                 worker_id = slot + 1;
+	struct worker_slot *worker    = &dispatcher->slots[slot];
+	chunk_t            *chunk     = &worker->chunks[worker->first];
+	unsigned            j         = chunk->n_finished++;
+	*stat = worker->reply;
+
+	/* the worker received the chunk & the task's warm start state, the buffers are free */
+	MPI_Wait(&chunk->requests[0], MPI_STATUS_IGNORE);
+	MPI_Wait(&chunk->requests[j + 1], MPI_STATUS_IGNORE);
+	if (warm_state != NULL) {
+		MPI_Recv(warm_state, (int)warm_length, MPI_DOUBLE, worker_id, WARM_TAG, dispatcher->comm, MPI_STATUS_IGNORE);
+	}
+	if (chunk->n_finished == chunk->size) {
+		worker->first = (worker->first + 1) % PREFETCH_CHUNKS;
+		worker->n_chunks--;
+	}
+	if (worker->n_chunks > 0) {
+		MPI_Irecv(&worker->reply, 1, dispatcher->stat_type, worker_id, DONE_TAG, dispatcher->comm,
+		          &dispatcher->replies[slot]);
+	}
+}
+
+bool probe_tree( pltb_dispatcher_t *dispatcher, MPI_Status *status )
+{
+	int flag = 0;
+	if (dispatcher->n_searching > 0) {
+		MPI_Iprobe(MPI_ANY_SOURCE, NEWICK_TAG, dispatcher->comm, &flag, status);
+	}
+	return flag != 0;
+}
+
+unsigned receive_tree( pltb_dispatcher_t *dispatcher, MPI_Status *status, char **newick )
+{
+	int                 length;
+	struct worker_slot *worker = &dispatcher->slots[status->MPI_SOURCE - 1];
+	MPI_Get_count(status, MPI_CHAR, &length);
+	*newick = malloc((size_t)length);
+	MPI_Recv(*newick, length, MPI_CHAR, status->MPI_SOURCE, NEWICK_TAG, dispatcher->comm, MPI_STATUS_IGNORE);
+	worker->searching = false;
+	dispatcher->n_searching--;
+	return worker->tree_task;
+}
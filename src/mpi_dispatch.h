@@ -0,0 +1,124 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MPI_DISPATCH_H
+#define MPI_DISPATCH_H
+
+#include <stdbool.h>
+#include <mpi.h>
+
+#include "mpi_backend.h"
+#include "pltb.h"
+
+/* the messages between master & workers */
+#define TASK_TAG 0
+#define DONE_TAG 1
+#define STOP_TAG 2
+#define WARM_TAG 3
+#define TREE_TAG 4
+#define NEWICK_TAG 5
+#define DATA_TAG 6
+#define SEED_TAG 7
+
+/* @see mpi_dispatch.c */
+struct worker_slot;
+
+/**
+ * The master's bookkeeping of the tasks handed to the workers. A worker holds the chunk of tasks it
+ * evaluates and the ones queued ahead, so it moves on to its next task without a round trip to the
+ * master. A receive is posted for the next result of every worker with tasks left. Idle workers
+ * search the trees of the current leaders speculatively.
+ */
+typedef struct {
+	int                 n_workers;
+	MPI_Comm            comm;
+	MPI_Datatype        task_type;
+	MPI_Datatype        stat_type;
+	/* one per worker (slot = worker id - 1) */
+	struct worker_slot *slots;
+	MPI_Request        *replies;
+	/* the slots of the results collected last (@see collect_results) */
+	int                *replied;
+	/* speculative tree searches not replied to yet */
+	unsigned            n_searching;
+} pltb_dispatcher_t;
+
+void init_dispatcher( pltb_dispatcher_t *dispatcher, int n_workers, MPI_Comm comm,
+		MPI_Datatype task_type, MPI_Datatype stat_type );
+
+/* completes the sends of the last speculative searches, all results have to be received */
+void destroy_dispatcher( pltb_dispatcher_t *dispatcher );
+
+/**
+ * Picks the worker to take the next chunk of tasks of dataset d: an idle one if any, otherwise one
+ * with room to queue the chunk ahead. Datasets are handed to idle workers only, so the master never
+ * blocks on sending to a worker busy evaluating.
+ * @param worker_datasets The dataset each worker holds
+ * @return The slot (worker id - 1) or -1 iff there is none
+ */
+int select_worker( pltb_dispatcher_t *dispatcher, unsigned *worker_datasets, unsigned d );
+
+/* @return The slot of a worker neither evaluating nor searching or -1 iff there is none */
+int idle_worker( pltb_dispatcher_t *dispatcher );
+
+/**
+ * Queues a chunk of tasks (@see guided_chunk_size) on the worker of a slot picked by select_worker.
+ * @param ids Identify the tasks to the master, handed back with their results (@see result_task)
+ * @param warm_states Per task the state to start from (@see pltb_task_t), kept until its result is received
+ */
+void send_chunk( pltb_dispatcher_t *dispatcher, int slot, pltb_task_t *tasks, unsigned *ids, unsigned size,
+		double **warm_states, unsigned warm_length );
+
+/**
+ * Hands the speculative tree search of a model to the worker of a slot picked by idle_worker.
+ * @param id Identifies the task to the master, handed back with the tree (@see receive_tree)
+ */
+void send_tree_search( pltb_dispatcher_t *dispatcher, int slot, unsigned id, unsigned matrix_index,
+		unsigned config_index );
+
+/**
+ * Collects the results arrived meanwhile, at most one per worker.
+ * @param block Wait for at least one result
+ * @return The number of results to receive (@see receive_result), 0 iff none arrived
+ */
+int collect_results( pltb_dispatcher_t *dispatcher, bool block );
+
+/* @return The id of the task of the r-th result collected (@see send_chunk) */
+unsigned result_task( pltb_dispatcher_t *dispatcher, int r );
+
+/**
+ * Receives the r-th result collected and posts the receive of the worker's next one.
+ * @param warm_state NULL or receives the optimized state of the task
+ */
+void receive_result( pltb_dispatcher_t *dispatcher, int r, pltb_model_stat_t *stat,
+		double *warm_state, unsigned warm_length );
+
+/**
+ * Checks for the tree of a speculative search (NEWICK_TAG) without waiting.
+ * @param status Announces the tree (@see receive_tree)
+ * @return true iff a tree arrived
+ */
+bool probe_tree( pltb_dispatcher_t *dispatcher, MPI_Status *status );
+
+/**
+ * Receives the (possibly already outdated) speculative tree announced by probe_tree.
+ * @param newick Receives the tree, free after use
+ * @return The id of the task (@see send_tree_search)
+ */
+unsigned receive_tree( pltb_dispatcher_t *dispatcher, MPI_Status *status, char **newick );
+
+#endif
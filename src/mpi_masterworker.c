@@ -22,8 +22,18 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <float.h>
+#include <limits.h>
+#include <pthread.h>
+#include "alignment.h"
+#include "cache.h"
+#include "climb.h"
+#include "journal.h"
 #include "mpi_backend.h"
+#include "mpi_dispatch.h"
 #include "pltb_frontend.h"
+#include "scheduler.h"
+#include "screen.h"
+#include "sink.h"
 
 #include "mpi_masterworker.h"
 
@@ -38,115 +48,1241 @@
 //#define DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT fopen("performance.txt", "w")
 //#define DEBUG_PROCESS_STATISTICS_CLOSE_OUTPUT(f) fclose(f)
 
-#define TASK_TAG 0
-#define DONE_TAG 1
-#define STOP_TAG 2
+/* a context not built for any configuration, a worker not holding any dataset, a worker not searching any tree */
+#define NO_CONFIG   UINT_MAX
+#define NO_DATASET  UINT_MAX
+#define NO_POSITION UINT_MAX
+
+/* the master checks for finished local evaluations this often while waiting for the workers */
+#define LOCAL_POLL_INTERVAL_NS 100000
 
 static MPI_Datatype mpi_task_type;
 static MPI_Datatype mpi_result_type;
 static MPI_Datatype mpi_model_stat_type;
 static MPI_Op mpi_result_reduce_op;
 
-static void master(int process_id, int n_workers,
-		MPI_Comm root_comm, MPI_Comm inter_comm,
-		pllAlignmentData *data, pltb_config_t *config,
-		model_space_t *model_space, bool print_progress)
+/* a dataset of the batch, read by the master and handed to the workers on demand */
+typedef struct {
+	char             *file;
+	pllAlignmentData *data;
+	/* the uncommitted MSA as sent to the workers (lazy batches only) */
+	pltb_packed_alignment_t packed;
+	uint64_t          fingerprint;
+	/* master bookkeeping: tasks not finished yet, optimized states per task (if warm starting) */
+	unsigned          unfinished;
+	unsigned          warm_length;
+	double           *warm_states;
+} dataset_t;
+
+/* configurations evaluated as one pool of tasks: task = config_index * matrix_count + model.
+ * The configurations of a dataset are consecutive (@see dataset_of). */
+typedef struct {
+	pltb_config_t *configs;
+	/* computed once per configuration by the master */
+	char         **start_trees;
+	unsigned       n_configs;
+	dataset_t     *datasets;
+	unsigned       n_datasets;
+	unsigned       n_dataset_configs;
+	/* several datasets => loaded one after another by the master, sent to the workers on demand */
+	bool           lazy;
+} batch_t;
+
+static unsigned dataset_of(batch_t *batch, unsigned config_index)
 {
-	FILE *out = DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT;
+	return config_index / batch->n_dataset_configs;
+}
 
-	MPI_Status  status;
+/* the optimized state of a task, kept per dataset as the datasets differ in size */
+static double *warm_state_of(batch_t *batch, unsigned n_models, unsigned task)
+{
+	unsigned   d       = dataset_of(batch, task / n_models);
+	dataset_t *dataset = &batch->datasets[d];
+	return &dataset->warm_states[(task - d * batch->n_dataset_configs * n_models) * dataset->warm_length];
+}
 
-	MPI_Request requests [n_workers]; /* request handler */
-	pltb_task_t tasks    [n_workers]; /* send buffer */
+/**
+ * Reads a dataset of the batch (master only). Lazy batches pack the MSA for the workers and compute
+ * the starting trees right away, both need the MSA before its partitions are committed.
+ * @param caches The caches of all configurations, initialized for the ones of the dataset, or NULL
+ * @return 0 on success, 1 iff the dataset can't be read or a cache directory can't be created
+ */
+static int load_dataset(batch_t *batch, unsigned d, pltb_cache_t *caches, model_space_t *model_space)
+{
+	dataset_t *dataset = &batch->datasets[d];
+	unsigned   first   = d * batch->n_dataset_configs;
+	int        error   = 0;
+	pltb_profile_t *profile = batch->configs[first].profile;
+	TIME_STRUCT_INIT(phase);
+
+	PHASE_START(phase);
+	dataset->data        = read_alignment_data(dataset->file);
+	PHASE_END(profile, PHASE_READ, phase);
+	if (dataset->data == NULL) {
+		return 1;
+	}
+	dataset->fingerprint = fingerprint_dataset(dataset->file, dataset->data);
+	for (unsigned c = first; !error && caches != NULL && c < first + batch->n_dataset_configs; c++) {
+		error = init_cache(&caches[c], batch->configs[c].cache_dir,
+				dataset->fingerprint, fingerprint_config(&batch->configs[c]), model_space);
+	}
+	if (batch->lazy) {
+		pack_alignment_data(dataset->data, &dataset->packed);
+		compute_start_trees(&batch->configs[first], batch->n_dataset_configs, dataset->data,
+		                    &batch->start_trees[first]);
+	}
+	return error;
+}
 
-	pltb_model_stat_t stats[model_space->matrix_count];
+/**
+ * Counts a finished task of a dataset. Once all tasks of a dataset of a lazy batch are finished, the
+ * master drops its MSA, the packed one and the starting trees remain for the tree searches.
+ */
+static void finish_dataset_task(batch_t *batch, unsigned d)
+{
+	dataset_t *dataset = &batch->datasets[d];
+	if (--dataset->unfinished > 0 || !batch->lazy) return;
+
+	pllAlignmentDataDestroy(dataset->data);
+	dataset->data = NULL;
+	free(dataset->warm_states);
+	dataset->warm_states = NULL;
+}
 
-	int send_index = 0;
+/**
+ * Hands a dataset of a lazy batch to a worker unless it holds it already: the packed MSA
+ * followed by the starting trees of the dataset's configurations (@see receive_dataset).
+ * @param worker_datasets The dataset held per worker, updated
+ */
+static void provide_dataset(int worker_id, MPI_Comm root_comm, batch_t *batch, unsigned *worker_datasets, unsigned d)
+{
+	if (worker_datasets[worker_id - 1] == d) return;
+
+	dataset_t  *dataset = &batch->datasets[d];
+	pltb_task_t header  = { .config_index = d * batch->n_dataset_configs };
+	MPI_Send(&header, 1, mpi_task_type, worker_id, DATA_TAG, root_comm);
+	MPI_Send(dataset->packed.bytes, (int)dataset->packed.size, MPI_BYTE, worker_id, DATA_TAG, root_comm);
+	for (unsigned c = header.config_index; c < header.config_index + batch->n_dataset_configs; c++) {
+		MPI_Send(batch->start_trees[c], (int)strlen(batch->start_trees[c]) + 1, MPI_CHAR,
+		         worker_id, DATA_TAG, root_comm);
+	}
+	worker_datasets[worker_id - 1] = d;
+}
 
-	DBG_MASTER("Master[%d]: Issuing initial workload...\n", process_id);
+/**
+ * The MSA of a worker. PLL instances hold their own copy of the site patterns, so the worker keeps
+ * the packed MSA only and unpacks it while setting up an instance (@see unpack_worker_alignment).
+ * With a shared alignment the packed MSA is the node's copy, mapped from its window.
+ */
+typedef struct {
+	pltb_packed_alignment_t packed;
+	/* the packed MSA belongs to the node's shared window (@see map_worker_alignment) */
+	bool                    mapped;
+	/* the dimensions only (@see shrink_alignment_data), for the information criteria */
+	pllAlignmentData       *shape;
+} worker_alignment_t;
+
+/* takes over the packed MSA, NULL bytes => no dataset yet */
+static void init_worker_alignment(worker_alignment_t *alignment, pltb_packed_alignment_t *packed)
+{
+	alignment->packed = *packed;
+	alignment->mapped = false;
+	alignment->shape  = NULL;
+	if (packed->bytes != NULL) {
+		pllAlignmentData *data = unpack_alignment_data(packed->bytes, packed->size);
+		assert(data != NULL);
+		alignment->shape = shrink_alignment_data(data);
+		pllAlignmentDataDestroy(data);
+	}
+}
 
-	while (next_model(model_space)) {
-		/* setup task */
-		tasks[send_index].matrix_index         = model_space->matrix_index;
-		tasks[send_index].free_parameter_count = model_space->free_parameter_count;
+static void destroy_worker_alignment(worker_alignment_t *alignment)
+{
+	if (alignment->packed.bytes != NULL && !alignment->mapped) {
+		destroy_packed_alignment(&alignment->packed);
+	}
+	if (alignment->shape != NULL) {
+		pllAlignmentDataDestroy(alignment->shape);
+		alignment->shape = NULL;
+	}
+}
 
-		DBG_MASTER("Master[%d] -> Worker[%02u]: Matrix #%03u with K = %u\n",
-		           process_id, send_index + 1, model_space->matrix_index,
-		           model_space->free_parameter_count);
+/* maps the node's shared MSA instead of holding a private copy, the window outlives the worker's MSA */
+static void map_worker_alignment(worker_alignment_t *alignment, pltb_shared_alignment_t *shared)
+{
+	pltb_packed_alignment_t packed = { shared->bytes, shared->size };
+	init_worker_alignment(alignment, &packed);
+	alignment->mapped = true;
+}
 
-		/* send task */
-		MPI_Isend(&tasks[send_index], 1, mpi_task_type, send_index + 1,
-		          TASK_TAG, root_comm, &requests[send_index]);
+/* the full MSA for setting up an instance, don't forget to destroy it right afterwards */
+static pllAlignmentData *unpack_worker_alignment(worker_alignment_t *alignment)
+{
+	pllAlignmentData *data = unpack_alignment_data(alignment->packed.bytes, alignment->packed.size);
+	assert(data != NULL);
+	return data;
+}
 
-		/* break when all workers received exactly one task */
-		if (++send_index == n_workers) break;
+/**
+ * PLL may compress the unpacked MSA while setting up the instance. The criteria count the sites
+ * as the instance sees them, like the other backends do with their MSA.
+ */
+static void adopt_instance_shape(worker_alignment_t *alignment, pllAlignmentData *data)
+{
+	if (alignment->shape != NULL) {
+		pllAlignmentDataDestroy(alignment->shape);
 	}
+	alignment->shape = shrink_alignment_data(data);
+}
 
-	DBG_MASTER("Master[%d]: Switching to on demand work distribution...\n", process_id);
+/**
+ * Receives a dataset of a lazy batch (@see provide_dataset), evicting the one held before.
+ * The starting trees of its configurations are stored in the batch.
+ */
+static void receive_dataset(int master_id, MPI_Comm root_comm, batch_t *batch, worker_alignment_t *alignment)
+{
+	MPI_Status  status;
+	pltb_task_t header;
+	int         size;
+
+	MPI_Recv(&header, 1, mpi_task_type, master_id, DATA_TAG, root_comm, MPI_STATUS_IGNORE);
+	destroy_worker_alignment(alignment);
+	for (unsigned c = 0; c < batch->n_configs; c++) {
+		free(batch->start_trees[c]);
+		batch->start_trees[c] = NULL;
+	}
 
-	unsigned finish_ctr = 0;
-	unsigned progress   = 0;
-	if (print_progress) { fprint_progress_begin(out); }
+	MPI_Probe(master_id, DATA_TAG, root_comm, &status);
+	MPI_Get_count(&status, MPI_BYTE, &size);
+	pltb_packed_alignment_t packed = { malloc((size_t)size), (size_t)size };
+	MPI_Recv(packed.bytes, size, MPI_BYTE, master_id, DATA_TAG, root_comm, MPI_STATUS_IGNORE);
+	init_worker_alignment(alignment, &packed);
+
+	for (unsigned c = header.config_index; c < header.config_index + batch->n_dataset_configs; c++) {
+		MPI_Probe(master_id, DATA_TAG, root_comm, &status);
+		MPI_Get_count(&status, MPI_CHAR, &size);
+		batch->start_trees[c] = malloc((size_t)size);
+		MPI_Recv(batch->start_trees[c], size, MPI_CHAR, master_id, DATA_TAG, root_comm, MPI_STATUS_IGNORE);
+	}
+}
 
-	while (next_model(model_space)) {
+/**
+ * Optimizes one model within the evaluation context.
+ * @param warm_state The optimized state of a parent model (or of the model itself while refining)
+ *                   or NULL to start from the starting state
+ * @param refine The model is a contender of a screening, optimized at full precision
+ * @param profile Receives the phases of the evaluation, NULL => not profiled
+ */
+static void evaluate_model(pltb_eval_context_t *context, model_space_t *model_space, pllAlignmentData *data,
+		pltb_config_t *config, unsigned matrix_index, double *warm_state, bool refine, pltb_model_stat_t *stat,
+		pltb_profile_t *profile)
+{
+	TIME_STRUCT_INIT(timer);
+	TIME_STRUCT_INIT(phase);
+	pltb_counter_sample_t counters;
+
+	set_model(model_space, matrix_index);
+	PHASE_START(phase);
+	if (warm_state != NULL) {
+		/* start from the optimized state of a parent model */
+		warm_start_eval_context(context, model_space->matrix_repr, warm_state);
+	} else {
+		reset_eval_context(context, model_space->matrix_repr);
+	}
+	PHASE_END(profile, PHASE_RESET, phase);
+
+	/* initiate time measuring */
+	stat->matrix_index = matrix_index;
+	sample_counters(&counters);
+	TIME_START(timer);
 
-		/* wait for free send slot */
-		MPI_Waitany(n_workers, requests, &send_index, MPI_STATUS_IGNORE);
-		if (send_index == MPI_UNDEFINED) {
-			fprintf(stderr, "Master[%d]: Internal error occured.\n", process_id);
-			exit(1);
+	/* the time intensive work.. */
+	optimize_model_parameters(context->inst, context->parts, evaluation_epsilon(config, context->inst, refine));
+
+	/* measure and store time */
+	TIME_END(timer);
+	add_model_counters(profile, absolute_model_index(model_space, matrix_index), &counters);
+	stat->time_cpu  = TIME_CPU(timer);
+	stat->time_real = TIME_REAL(timer);
+	add_phase(profile, PHASE_OPTIMIZE, stat->time_cpu, stat->time_real);
+
+	stat->likelihood = context->inst->likelihood;
+	calculate_model_ICs(stat, data, model_space->free_parameter_count, config);
+}
+
+/**
+ * Rebuilds the context for another configuration of the batch (if it isn't built for it already).
+ * @param context_config The configuration the context is built for, updated
+ * @param profile Receives the setup of the context, NULL => not profiled
+ */
+static void switch_eval_context(pltb_eval_context_t *context, unsigned *context_config, unsigned config_index,
+		batch_t *batch, pllAlignmentData *data, pltb_profile_t *profile)
+{
+	if (*context_config == config_index) return;
+	TIME_STRUCT_INIT(phase);
+	PHASE_START(phase);
+
+	pltb_config_t *config = &batch->configs[config_index];
+	if (context->inst != NULL) {
+		destroy_eval_context(context);
+	}
+	init_eval_context(context, &config->attr_model_eval, data, config->base_freq_kind, config->rate_het,
+	                  batch->start_trees[config_index]);
+	*context_config = config_index;
+	PHASE_END(profile, PHASE_SETUP, phase);
+}
+
+/* switch_eval_context for a worker, its MSA unpacked for the setup only */
+static void switch_worker_context(pltb_eval_context_t *context, unsigned *context_config, unsigned config_index,
+		batch_t *batch, worker_alignment_t *alignment, pltb_profile_t *profile)
+{
+	if (*context_config == config_index) return;
+	pllAlignmentData *data = unpack_worker_alignment(alignment);
+	switch_eval_context(context, context_config, config_index, batch, data, profile);
+	adopt_instance_shape(alignment, data);
+	pllAlignmentDataDestroy(data);
+}
+
+/* evaluates models on the master process, next to the work distribution */
+typedef struct {
+	pthread_t       thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;
+	/* protected by mutex */
+	bool            busy;
+	bool            done;
+	bool            stop;
+	unsigned        config_index;
+	unsigned        matrix_index;
+	bool            warm_start;
+	bool            refine;
+	/* parent state on input, the own optimized state on output */
+	double         *warm_state;
+	pltb_model_stat_t stat;
+	/* owned by the thread */
+	pltb_eval_context_t *context;
+	unsigned        context_config;
+	model_space_t   model_space;
+	batch_t        *batch;
+	/* merged into the master's profile (if any) once the thread is stopped */
+	pltb_profile_t  profile;
+} local_evaluator_t;
+
+static void *run_local_evaluator(void *arg)
+{
+	local_evaluator_t *local = arg;
+
+	pthread_mutex_lock(&local->mutex);
+	while (true) {
+		while (!local->stop && (!local->busy || local->done)) {
+			pthread_cond_wait(&local->cond, &local->mutex);
 		}
+		if (local->stop) break;
+		pthread_mutex_unlock(&local->mutex);
 
-		/* wait for worker to finish its task */
+		/* the master does not touch the task while busy */
+		pltb_config_t    *config = &local->batch->configs[local->config_index];
+		pllAlignmentData *data   = local->batch->datasets[dataset_of(local->batch, local->config_index)].data;
 		pltb_model_stat_t stat;
-		/* response contains task-specific evaluation information */
-		MPI_Recv(&stat, 1, mpi_model_stat_type, MPI_ANY_SOURCE,
-		         DONE_TAG, root_comm, &status);
-		if (print_progress) { progress = fprint_progress_step(out, progress, ++finish_ctr, model_space->matrix_count); }
-		stats[stat.matrix_index] = stat;
+		pltb_profile_t   *profile = config->profile != NULL ? &local->profile : NULL;
+		switch_eval_context(local->context, &local->context_config, local->config_index,
+		                    local->batch, data, profile);
+		evaluate_model(local->context, &local->model_space, data, config,
+		               local->matrix_index, local->warm_start ? local->warm_state : NULL, local->refine, &stat,
+		               profile);
+		if (config->warm_start) {
+			save_warm_start(local->context, local->warm_state);
+		}
 
-		/* setup new task */
-		tasks[send_index].matrix_index         = model_space->matrix_index;
-		tasks[send_index].free_parameter_count = model_space->free_parameter_count;
+		pthread_mutex_lock(&local->mutex);
+		local->stat = stat;
+		local->done = true;
+	}
+	pthread_mutex_unlock(&local->mutex);
+	return NULL;
+}
 
-		DBG_MASTER("Master[%d] -> Worker[%02u]: Matrix #%03u with K = %u\n",
-		           process_id, status.MPI_SOURCE,
-		           model_space->matrix_index, model_space->free_parameter_count);
+/**
+ * @param context Built for the first configuration of the batch
+ */
+static void init_local_evaluator(local_evaluator_t *local, pltb_eval_context_t *context,
+		model_space_t *model_space, batch_t *batch)
+{
+	local->busy    = false;
+	local->done    = false;
+	local->stop    = false;
+	local->context = context;
+	local->context_config = 0;
+	/* own copy, the master changes the current model of its model space */
+	local->model_space = *model_space;
+	local->batch   = batch;
+	/* sized per dataset on dispatch */
+	local->warm_state = NULL;
+	init_profile(&local->profile);
+	pthread_mutex_init(&local->mutex, NULL);
+	pthread_cond_init(&local->cond, NULL);
+	pthread_create(&local->thread, NULL, &run_local_evaluator, local);
+}
+
+static void destroy_local_evaluator(local_evaluator_t *local)
+{
+	pthread_mutex_lock(&local->mutex);
+	local->stop = true;
+	pthread_cond_signal(&local->cond);
+	pthread_mutex_unlock(&local->mutex);
+	pthread_join(local->thread, NULL);
+	pthread_cond_destroy(&local->cond);
+	pthread_mutex_destroy(&local->mutex);
+	free(local->warm_state);
+	merge_profile(local->batch->configs[0].profile, &local->profile);
+}
 
-		/* send new task */
-		MPI_Isend(&tasks[send_index], 1, mpi_task_type, status.MPI_SOURCE,
-		          TASK_TAG, root_comm, &requests[send_index]);
+/**
+ * Hands a model to the (idle) local evaluator.
+ * @param warm_state The state to start from (@see select_start_state) or NULL
+ * @param warm_length The length of the warm start states of the model's dataset
+ */
+static void dispatch_local(local_evaluator_t *local, unsigned config_index, unsigned matrix_index,
+		double *warm_state, unsigned warm_length, bool refine)
+{
+	pthread_mutex_lock(&local->mutex);
+	assert(!local->busy);
+	local->config_index = config_index;
+	local->matrix_index = matrix_index;
+	local->warm_start   = warm_state != NULL;
+	local->refine       = refine;
+	if (local->batch->configs[config_index].warm_start) {
+		/* the datasets of a batch differ in size */
+		local->warm_state = realloc(local->warm_state, sizeof(double) * warm_length);
+	}
+	if (warm_state != NULL) {
+		memcpy(local->warm_state, warm_state, sizeof(double) * warm_length);
 	}
+	local->busy = true;
+	pthread_cond_signal(&local->cond);
+	pthread_mutex_unlock(&local->mutex);
+}
 
-	DBG_MASTER("Master[%d]: Distribution complete. Sending shutdown signals...\n", process_id);
+/**
+ * Fetches the result of the local evaluator (if finished), making it idle again.
+ * @param warm_state Destination of the optimized state (if warm starting)
+ */
+static bool collect_local(local_evaluator_t *local, pltb_model_stat_t *stat, double *warm_state, unsigned warm_length)
+{
+	pthread_mutex_lock(&local->mutex);
+	bool done = local->done;
+	if (done) {
+		*stat = local->stat;
+		if (warm_state != NULL) {
+			memcpy(warm_state, local->warm_state, sizeof(double) * warm_length);
+		}
+		local->busy = false;
+		local->done = false;
+	}
+	pthread_mutex_unlock(&local->mutex);
+	return done;
+}
 
-	int iterations = n_workers;
-	while (iterations--) {
+/**
+ * Chooses the optimized state a task starts from (if warm starting): the own screening
+ * optimum of a contender, the state of the best evaluated parent otherwise.
+ * @param refining Per task, released again to re-optimize a contender of a screening
+ * @param evaluated Per task, evaluated by this run (journaled & cached ones provide no state)
+ * @param origin The task whose state to start from
+ * @return false iff the task starts from the starting state
+ */
+static bool select_start_state(model_space_t *model_space, pltb_config_t *config, unsigned task,
+		bool *refining, bool *evaluated, pltb_model_stat_t *stats, unsigned *origin)
+{
+	unsigned offset = task - task % model_space->matrix_count;
+	unsigned parent;
+	if (!config->warm_start) {
+		return false;
+	}
+	if (refining[task]) {
+		*origin = task;
+		return evaluated[task];
+	}
+	if (select_warm_start_parent(model_space, task % model_space->matrix_count,
+	                             &evaluated[offset], &stats[offset], &parent)) {
+		*origin = offset + parent;
+		return true;
+	}
+	return false;
+}
 
-		/* wait for free send slot */
-		MPI_Waitany(n_workers, requests, &send_index, MPI_STATUS_IGNORE);
-		if (send_index == MPI_UNDEFINED) {
-			fprintf(stderr, "Master[%d]: Internal error occured.\n", process_id);
-			exit(1);
+/**
+ * Finds the task with the highest predicted cost neither dispatched yet nor waiting
+ * for the evaluation of a parent (longest task first). The configurations of a batch
+ * are handed out one after another, so workers rarely have to switch configurations.
+ * @param released Tasks in the pool (all or the current frontier of a greedy climb)
+ * @param finished Evaluated or preloaded tasks
+ * @param cost_models One per configuration
+ * @param K The number of rate classes per model
+ */
+static bool next_ready_task(model_space_t *model_space, unsigned n_configs, bool *released, bool *dispatched,
+		bool *finished, bool warm_start, pltb_cost_model_t *cost_models, unsigned *K, unsigned *task)
+{
+	for (unsigned c = 0; c < n_configs; c++) {
+		unsigned offset    = c * model_space->matrix_count;
+		bool     found     = false;
+		double   best_cost = 0;
+		for (unsigned i = 0; i < model_space->matrix_count; i++) {
+			if (!released[offset + i] || dispatched[offset + i]) continue;
+			if (warm_start) {
+				unsigned parents[MAX_PARENT_MODELS];
+				unsigned n_parents = parent_models(model_space, i, parents);
+				bool ready = n_parents == 0;
+				for (unsigned j = 0; j < n_parents; j++) {
+					ready = ready || finished[offset + parents[j]];
+				}
+				if (!ready) continue;
+			}
+			double cost = predict_cost(&cost_models[c], K[i]);
+			if (!found || cost > best_cost) {
+				*task     = offset + i;
+				best_cost = cost;
+				found     = true;
+			}
 		}
+		if (found) return true;
+	}
+	return false;
+}
 
-		/* wait for worker to finish its task */
-		pltb_model_stat_t stat;
-		/* response contains task-specific evaluation information */
-		MPI_Recv(&stat, 1, mpi_model_stat_type, MPI_ANY_SOURCE,
-		         DONE_TAG, root_comm, &status);
-		if (print_progress) { progress = fprint_progress_step(out, progress, ++finish_ctr, model_space->matrix_count); }
-		stats[stat.matrix_index] = stat;
+/**
+ * Finds a current leader (best evaluated model of an information criterion
+ * within its configuration) without a tree search yet.
+ */
+static bool next_speculative_task(model_space_t *model_space, unsigned n_configs, pltb_model_stat_t *stats,
+		bool *finished, bool *searched, unsigned *task)
+{
+	for (unsigned offset = 0; offset < n_configs * model_space->matrix_count; offset += model_space->matrix_count) {
+		for (unsigned i = 0; i < IC_MAX; i++) {
+			bool found = false;
+			unsigned leader = 0;
+			for (unsigned j = offset; j < offset + model_space->matrix_count; j++) {
+				if (finished[j] && (!found || stats[j].ic[i] < stats[leader].ic[i])) {
+					leader = j;
+					found  = true;
+				}
+			}
+			if (found && !searched[leader]) {
+				*task = leader;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Hands the next model without a tree to the given worker (if any). With seeded tree searches, the first search
+ * of a configuration replies its ML tree, the others of the configuration wait for it as their start (@see search_tree).
+ * @param seeds The ML tree per configuration, NULL => none yet
+ * @param seeding Per configuration, the search replying its ML tree has been dispatched
+ */
+static void dispatch_tree_search(int worker_id, MPI_Comm root_comm, batch_t *batch, unsigned *worker_datasets,
+		unsigned *models, unsigned *model_configs, char **newicks, bool *dispatched, unsigned n_models,
+		char **seeds, bool *seeding, unsigned *assigned)
+{
+	unsigned position = 0;
+	for (; position < n_models; position++) {
+		unsigned c = model_configs[position];
+		if (newicks[position] == NULL && !dispatched[position]
+				&& (!batch->configs[c].seed_tree_searches || seeds[c] != NULL || !seeding[c])) break;
+	}
+	if (position == n_models) {
+		assigned[worker_id - 1] = NO_POSITION;
+		return;
+	}
+	unsigned c = model_configs[position];
+
+	provide_dataset(worker_id, root_comm, batch, worker_datasets, dataset_of(batch, c));
+
+	pltb_task_t task = { .matrix_index = models[position], .config_index = c };
+	assigned[worker_id - 1] = position;
+	dispatched[position]    = true;
+	MPI_Send(&task, 1, mpi_task_type, worker_id, TREE_TAG, root_comm);
+	if (batch->configs[c].seed_tree_searches) {
+		/* an empty seed orders the worker to reply the ML tree */
+		char *seed = seeds[c] != NULL ? seeds[c] : "";
+		seeding[c] = true;
+		MPI_Send(seed, (int)strlen(seed) + 1, MPI_CHAR, worker_id, SEED_TAG, root_comm);
+	}
+}
+
+/**
+ * Distributes the tree searches for the selected models of all configurations among the workers and
+ * prints the resulting trees to the output of their configuration in the order of the sequential implementation.
+ * @param results The result per configuration
+ * @param speculative_trees Per task, taken over iff the model kept its lead
+ * @param worker_datasets The dataset held per worker, updated
+ */
+static void distribute_tree_searches(int n_workers, MPI_Comm root_comm, model_space_t *model_space,
+		batch_t *batch, pltb_result_t *results, char **speculative_trees, unsigned *worker_datasets)
+{
+	unsigned capacity = 0;
+	for (unsigned c = 0; c < batch->n_configs; c++) {
+		capacity += IC_MAX + batch->configs[c].n_extra_models;
+	}
+
+	/* the models of all configurations, one configuration after another */
+	unsigned models       [capacity];
+	unsigned model_configs[capacity];
+	unsigned n_models = 0;
+	for (unsigned c = 0; c < batch->n_configs; c++) {
+		unsigned n = prepare_tree_searches(model_space, &results[c], &batch->configs[c], &models[n_models]);
+		for (unsigned i = n_models; i < n_models + n; i++) {
+			model_configs[i] = c;
+		}
+		n_models += n;
+	}
+
+	model_space_t all_models;
+	init_default_model_space(&all_models);
+
+	char        *newicks   [n_models];  /* received trees */
+	bool         dispatched[n_models];
+	unsigned     assigned  [n_workers]; /* position of the model a worker is busy with */
+	char        *seeds     [batch->n_configs];
+	bool         seeding   [batch->n_configs];
+	memset(newicks, 0, sizeof(newicks));
+	memset(dispatched, 0, sizeof(dispatched));
+	memset(seeds, 0, sizeof(seeds));
+	memset(seeding, 0, sizeof(seeding));
+
+	/* take over the speculative trees of models which kept the lead */
+	if (speculative_trees != NULL) {
+		for (unsigned i = 0; i < n_models; i++) {
+			unsigned index;
+			if (relative_model_index(model_space, models[i], &index)) {
+				unsigned task = model_configs[i] * model_space->matrix_count + index;
+				newicks[i] = speculative_trees[task];
+				speculative_trees[task] = NULL;
+			}
+		}
+	}
+
+	unsigned printed = 0;
+	TIME_STRUCT_INIT(phase);
+
+	for (int worker_id = 1; worker_id <= n_workers; worker_id++) {
+		dispatch_tree_search(worker_id, root_comm, batch, worker_datasets,
+		                     models, model_configs, newicks, dispatched, n_models, seeds, seeding, assigned);
+	}
+
+	while (true) {
+		MPI_Status status;
+		int length;
+
+		/* print all trees available in order */
+		while (printed < n_models && newicks[printed] != NULL) {
+			unsigned c = model_configs[printed];
+			pltb_config_t *config = &batch->configs[c];
+			if (printed == 0 || model_configs[printed - 1] != c) {
+				open_output(config);
+				fprint_tree_search_header(config->output);
+			}
+			set_model(&all_models, models[printed]);
+			fprint_tree_search_pretext(config->output, all_models.matrix_repr_short, &results[c], models[printed]);
+			fprint_tree(config->output, newicks[printed]);
+			if (config->sink != NULL) {
+				sink_tree(config->sink, config, all_models.matrix_repr_short, &results[c], models[printed], newicks[printed]);
+			}
+			free(newicks[printed]);
+			printed++;
+			if (printed == n_models || model_configs[printed] != c) {
+				close_output(config);
+			}
+		}
+		if (printed == n_models) break;
+
+		PHASE_START(phase);
+		MPI_Probe(MPI_ANY_SOURCE, NEWICK_TAG, root_comm, &status);
+		PHASE_END(batch->configs[0].profile, PHASE_WAIT, phase);
+		MPI_Get_count(&status, MPI_CHAR, &length);
+		int worker_id = status.MPI_SOURCE;
+		unsigned position = assigned[worker_id - 1];
+		newicks[position] = malloc((size_t)length);
+		MPI_Recv(newicks[position], length, MPI_CHAR, worker_id, NEWICK_TAG, root_comm, MPI_STATUS_IGNORE);
+
+		unsigned c = model_configs[position];
+		if (batch->configs[c].seed_tree_searches && seeds[c] == NULL) {
+			MPI_Probe(worker_id, SEED_TAG, root_comm, &status);
+			MPI_Get_count(&status, MPI_CHAR, &length);
+			seeds[c] = malloc((size_t)length);
+			MPI_Recv(seeds[c], length, MPI_CHAR, worker_id, SEED_TAG, root_comm, MPI_STATUS_IGNORE);
+
+			/* the searches waiting for the seed go to the idle workers */
+			for (int idle_id = 1; idle_id <= n_workers; idle_id++) {
+				if (idle_id != worker_id && assigned[idle_id - 1] == NO_POSITION) {
+					dispatch_tree_search(idle_id, root_comm, batch, worker_datasets,
+					                     models, model_configs, newicks, dispatched, n_models, seeds, seeding, assigned);
+				}
+			}
+		}
+
+		dispatch_tree_search(worker_id, root_comm, batch, worker_datasets,
+		                     models, model_configs, newicks, dispatched, n_models, seeds, seeding, assigned);
+	}
+
+	for (int worker_id = 1; worker_id <= n_workers; worker_id++) {
+		MPI_Send(NULL, 0, mpi_task_type, worker_id, STOP_TAG, root_comm);
+	}
+	for (unsigned c = 0; c < batch->n_configs; c++) {
+		free(seeds[c]);
+	}
+
+	destroy_model_space(&all_models);
+}
+
+/**
+ * Writes the evaluation table & selection of every configuration of the batch to its output.
+ * @param stats Per task, final
+ * @param climbs NULL or the greedy climbs per configuration, destroyed afterwards
+ * @param refining NULL or per task, the contenders of a screening
+ * @param results Per configuration, relative model indices
+ */
+static void write_results(batch_t *batch, model_space_t *model_space, pltb_model_stat_t *stats,
+		pltb_climb_t *climbs, bool *refining, pltb_result_t *results)
+{
+	unsigned n_models = model_space->matrix_count;
+	for (unsigned c = 0; c < batch->n_configs; c++) {
+		pltb_config_t *job = &batch->configs[c];
+		unsigned contenders[n_models];
+		unsigned n_contenders = 0;
+		for (unsigned i = 0; refining != NULL && i < n_models; i++) {
+			if (refining[c * n_models + i]) {
+				contenders[n_contenders++] = i;
+			}
+		}
+		open_output(job);
+		fprint_eval_header(job->output, job);
+		report_eval_results(job->output, job, model_space, &stats[c * n_models], true, &results[c],
+		                    climbs != NULL ? &climbs[c] : NULL, contenders, n_contenders);
+		if (climbs != NULL) {
+			destroy_climb(&climbs[c]);
+		}
+		close_output(job);
+	}
+}
+
+/**
+ * The master's bookkeeping of the tasks (configuration × model) of a batch. Tasks join the pool when their
+ * dataset is loaded, all at once or the frontiers of a greedy climb one after another. Released tasks are
+ * looked up in the journal & caches first (fresh). The per task arrays live on the heap, batches of many
+ * datasets get large.
+ */
+typedef struct {
+	batch_t           *batch;
+	model_space_t     *model_space;
+	pltb_journal_t    *journal;
+	pltb_cache_t      *caches;      /* NULL or one per configuration */
+	unsigned           n_models;
+	unsigned           n_tasks;
+
+	pltb_model_stat_t *stats;       /* tasks left out by a greedy climb don't add to the summary */
+	/* warm start bookkeeping: parents have to be finished before their children,
+	 * only the ones evaluated by this run provide a warm start state (@see dataset_t) */
+	bool              *dispatched;
+	bool              *finished;
+	bool              *evaluated;
+	bool              *preloaded;   /* journaled or cached */
+	unsigned           n_preloaded;
+
+	/* longest task first, predicted by K and the timings observed so far */
+	pltb_cost_model_t *cost_models; /* one per configuration */
+	unsigned          *K;           /* per model */
+
+	bool              *released;
+	unsigned          *fresh;
+	unsigned           n_fresh;
+	unsigned          *pending;     /* per configuration: released, not finished */
+	pltb_climb_t      *climbs;      /* NULL or one per configuration */
+	unsigned          *stalled;     /* climbs with a finished frontier */
+	unsigned           n_stalled;
+	unsigned           n_skipped;   /* left out by the climbs */
+
+	/* screening: once all models of a configuration are screened, its contenders are released again */
+	bool               screening;
+	bool              *refining;
+	bool              *refined;     /* per configuration: contenders released */
+	unsigned           n_screening; /* configurations not refined yet */
+	unsigned           n_refines;
+
+	unsigned           finish_ctr;
+	/* datasets whose tasks are in the pool, the next one joins once these lack ready tasks */
+	unsigned           n_loaded;
+} task_pool_t;
+
+static void init_task_pool(task_pool_t *pool, batch_t *batch, model_space_t *model_space,
+		pltb_journal_t *journal, pltb_cache_t *caches)
+{
+	unsigned n_models = model_space->matrix_count;
+	unsigned n_tasks  = batch->n_configs * n_models;
+	pool->batch       = batch;
+	pool->model_space = model_space;
+	pool->journal     = journal;
+	pool->caches      = caches;
+	pool->n_models    = n_models;
+	pool->n_tasks     = n_tasks;
+
+	pool->stats       = calloc(n_tasks, sizeof(pltb_model_stat_t));
+	pool->dispatched  = calloc(n_tasks, sizeof(bool));
+	pool->finished    = calloc(n_tasks, sizeof(bool));
+	pool->evaluated   = calloc(n_tasks, sizeof(bool));
+	pool->preloaded   = calloc(n_tasks, sizeof(bool));
+	pool->n_preloaded = 0;
+
+	pool->cost_models = malloc(sizeof(pltb_cost_model_t) * batch->n_configs);
+	pool->K           = malloc(sizeof(unsigned) * n_models);
+	for (unsigned i = 0; i < n_models; i++) {
+		set_model(model_space, i);
+		pool->K[i] = model_space->K;
+	}
+
+	pool->released  = calloc(n_tasks, sizeof(bool));
+	pool->fresh     = malloc(sizeof(unsigned) * n_tasks);
+	pool->n_fresh   = 0;
+	pool->pending   = calloc(batch->n_configs, sizeof(unsigned));
+	pool->climbs    = batch->configs[0].greedy_climb ? malloc(sizeof(pltb_climb_t) * batch->n_configs) : NULL;
+	pool->stalled   = malloc(sizeof(unsigned) * batch->n_configs);
+	pool->n_stalled = 0;
+	pool->n_skipped = 0;
+
+	pool->screening   = batch->configs[0].screen_epsilon > 0;
+	pool->refining    = calloc(n_tasks, sizeof(bool));
+	pool->refined     = calloc(batch->n_configs, sizeof(bool));
+	pool->n_screening = pool->screening ? batch->n_configs : 0;
+	pool->n_refines   = 0;
+
+	pool->finish_ctr = 0;
+	pool->n_loaded   = 0;
+}
+
+/**
+ * The climbs have been destroyed by write_results already.
+ */
+static void destroy_task_pool(task_pool_t *pool)
+{
+	free(pool->refined);
+	free(pool->refining);
+	free(pool->climbs);
+	free(pool->stalled);
+	free(pool->pending);
+	free(pool->fresh);
+	free(pool->released);
+	free(pool->K);
+	free(pool->cost_models);
+	free(pool->preloaded);
+	free(pool->evaluated);
+	free(pool->finished);
+	free(pool->dispatched);
+	free(pool->stats);
+}
+
+static bool next_pool_task(task_pool_t *pool, unsigned *task)
+{
+	return next_ready_task(pool->model_space, pool->n_loaded * pool->batch->n_dataset_configs,
+	                       pool->released, pool->dispatched, pool->finished, pool->batch->configs[0].warm_start,
+	                       pool->cost_models, pool->K, task);
+}
+
+/**
+ * Counts a task of a configuration as finished with respect to its climb or screening and its dataset.
+ */
+static void settle_task(task_pool_t *pool, unsigned c)
+{
+	if (--pool->pending[c] == 0 && (pool->climbs != NULL || pool->screening) && !pool->refined[c]) {
+		pool->stalled[pool->n_stalled++] = c;
+	}
+	finish_dataset_task(pool->batch, dataset_of(pool->batch, c));
+}
+
+static void release_task(task_pool_t *pool, unsigned t)
+{
+	pool->released[t]            = true;
+	pool->fresh[pool->n_fresh++] = t;
+	pool->pending[t / pool->n_models]++;
+}
+
+/**
+ * The released models evaluated by an interrupted run or cached by any run are done already.
+ * Journals cover a single configuration, merged & printed once all tasks are done.
+ */
+static void preload_fresh_tasks(task_pool_t *pool)
+{
+	while (pool->n_fresh > 0) {
+		unsigned t = pool->fresh[--pool->n_fresh];
+		unsigned c = t / pool->n_models;
+		unsigned i = t % pool->n_models;
+		set_model(pool->model_space, i);
+		pool->preloaded[t] = preload_model(&pool->batch->configs[c], pool->model_space,
+		                                   pool->batch->datasets[dataset_of(pool->batch, c)].data, pool->journal,
+		                                   pool->caches != NULL ? &pool->caches[c] : NULL, &pool->stats[t], NULL, NULL);
+		if (pool->preloaded[t]) {
+			pool->dispatched[t] = true;
+			pool->finished[t]   = true;
+			pool->finish_ctr++;
+			pool->n_preloaded++;
+			observe_cost(&pool->cost_models[c], pool->K[i], pool->stats[t].time_real);
+			settle_task(pool, c);
+		}
+	}
+}
 
-		DBG_MASTER("Master[%d] -> Worker[%02d]: Switch to reduction mode!\n", process_id, status.MPI_SOURCE);
+/**
+ * Moves on a climb whose frontier is finished or, once it is over, refines the configuration screened completely.
+ * @return false iff no climb or screening stalled
+ */
+static bool advance_stalled(task_pool_t *pool)
+{
+	if (pool->n_stalled == 0) {
+		return false;
+	}
+	unsigned n_models = pool->n_models;
+	unsigned c        = pool->stalled[--pool->n_stalled];
+	if (pool->climbs != NULL && advance_climb(&pool->climbs[c], &pool->stats[c * n_models])) {
+		for (unsigned j = 0; j < pool->climbs[c].n_frontier; j++) {
+			release_task(pool, c * n_models + pool->climbs[c].frontier[j]);
+		}
+		return true;
+	}
+	if (pool->climbs != NULL) {
+		/* the climb is over, the models left out count as done */
+		for (unsigned t = c * n_models; t < (c + 1) * n_models; t++) {
+			if (pool->released[t]) continue;
+			pool->released[t]   = true;
+			pool->dispatched[t] = true;
+			pool->finish_ctr++;
+			pool->n_skipped++;
+			finish_dataset_task(pool->batch, dataset_of(pool->batch, c));
+		}
+	}
+	if (pool->screening) {
+		/* the contenders count as unfinished again, the dataset stays loaded for them */
+		unsigned contenders[n_models];
+		unsigned n_contenders = select_contenders(pool->model_space, &pool->stats[c * n_models],
+				&pool->finished[c * n_models], pool->batch->configs[c].screen_margin, contenders);
+		for (unsigned j = 0; j < n_contenders; j++) {
+			unsigned t = c * n_models + contenders[j];
+			pool->dispatched[t] = false;
+			pool->refining[t]   = true;
+			pool->pending[c]++;
+		}
+		pool->batch->datasets[dataset_of(pool->batch, c)].unfinished += n_contenders;
+		pool->finish_ctr -= n_contenders;
+		pool->n_refines  += n_contenders;
+		pool->refined[c]  = true;
+		pool->n_screening--;
+		finish_dataset_task(pool->batch, dataset_of(pool->batch, c));
+	}
+	return true;
+}
+
+/**
+ * The tasks in the pool lack ready ones: the next dataset joins.
+ */
+static void load_next_dataset(task_pool_t *pool)
+{
+	batch_t   *batch           = pool->batch;
+	unsigned   n_dataset_tasks = batch->n_dataset_configs * pool->n_models;
+	unsigned   d               = pool->n_loaded++;
+	unsigned   first           = d * batch->n_dataset_configs;
+	dataset_t *dataset         = &batch->datasets[d];
+	if (dataset->data == NULL) {
+		/* the cache directory exists already (@see run_master_worker) */
+		load_dataset(batch, d, pool->caches, pool->model_space);
+	}
+	/* screening holds the dataset once more per configuration until its contenders are released */
+	dataset->unfinished  = n_dataset_tasks + (pool->screening ? batch->n_dataset_configs : 0);
+	dataset->warm_length = warm_start_length(dataset->data->sequenceCount);
+	dataset->warm_states = batch->configs[0].warm_start
+		? malloc(sizeof(double) * dataset->warm_length * n_dataset_tasks) : NULL;
+	for (unsigned c = first; c < first + batch->n_dataset_configs; c++) {
+		init_cost_model(&pool->cost_models[c], dataset->data, &batch->configs[c]);
+		if (pool->climbs != NULL) {
+			init_climb(&pool->climbs[c], pool->model_space);
+			for (unsigned j = 0; j < pool->climbs[c].n_frontier; j++) {
+				release_task(pool, c * pool->n_models + pool->climbs[c].frontier[j]);
+			}
+		} else {
+			for (unsigned i = 0; i < pool->n_models; i++) {
+				release_task(pool, c * pool->n_models + i);
+			}
+		}
+		if (pool->pending[c] == 0 && (pool->climbs != NULL || pool->screening)) {
+			pool->stalled[pool->n_stalled++] = c;
+		}
+	}
+}
+
+/**
+ * Records the evaluation of a task by a worker or the local evaluator.
+ */
+static void finish_task(task_pool_t *pool, unsigned task, pltb_model_stat_t stat)
+{
+	unsigned       c      = task / pool->n_models;
+	pltb_config_t *config = &pool->batch->configs[c];
+	pool->finish_ctr++;
+	if (pool->refining[task]) {
+		add_screening_time(&stat, &pool->stats[task]);
+	} else {
+		/* cost model, journal & caches cover the screening */
+		observe_cost(&pool->cost_models[c], pool->K[task % pool->n_models], stat.time_real);
+		if (pool->journal != NULL) {
+			append_journal(pool->journal, &stat);
+		}
+		if (pool->caches != NULL) {
+			store_cache(&pool->caches[c], &stat);
+		}
+	}
+	pool->stats[task]     = stat;
+	pool->finished[task]  = true;
+	pool->evaluated[task] = true;
+	if (config->sink != NULL) {
+		set_model(pool->model_space, task % pool->n_models);
+		sink_model(config->sink, config, pool->model_space->matrix_repr_short, pool->model_space->K, &stat,
+		           pool->refining[task] ? "refined" : pool->screening ? "screening" : "full", false);
+	}
+	settle_task(pool, c);
+}
+
+static void master(int process_id, int n_workers,
+		MPI_Comm root_comm, MPI_Comm inter_comm,
+		batch_t *batch, model_space_t *model_space,
+		pltb_eval_context_t *local_context, pltb_journal_t *journal, pltb_cache_t *caches,
+		bool print_progress)
+{
+	FILE *out = DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT;
+	(void)process_id; /* debug messages only */
+
+	/* the settings below are the same for all configurations of the batch */
+	pltb_config_t *config   = &batch->configs[0];
+	unsigned       n_models = model_space->matrix_count;
+	unsigned       n_tasks  = batch->n_configs * n_models;
+
+	MPI_Status  status;
+
+	/* the tasks handed to the workers (@see mpi_dispatch.h) */
+	pltb_dispatcher_t dispatcher;
+	unsigned          worker_datasets[n_workers]; /* dataset a worker holds */
+	init_dispatcher(&dispatcher, n_workers, root_comm, mpi_task_type, mpi_model_stat_type);
+	for (int i = 0; i < n_workers; i++) {
+		worker_datasets[i] = batch->lazy ? NO_DATASET : 0;
+	}
+
+	task_pool_t pool;
+	init_task_pool(&pool, batch, model_space, journal, caches);
+	pltb_model_stat_t *stats = pool.stats;
+
+	/* speculative tree searches of tasks, reused iff the model keeps its lead */
+	char **speculative_trees = calloc(n_tasks, sizeof(char*));
+	bool  *searched          = calloc(n_tasks, sizeof(bool));
+
+	unsigned  n_orders     = pool.screening ? 2 * n_tasks : n_tasks; /* contenders are dispatched twice */
+	unsigned *order        = malloc(sizeof(unsigned) * n_orders); /* dispatch order */
+	unsigned  n_dispatched = 0;
+
+	/* the master evaluates models as well (if a context is given) */
+	local_evaluator_t local;
+	unsigned local_task  = 0;
+	bool local_idle      = local_context != NULL;
+	bool *local_evaluated = calloc(n_tasks, sizeof(bool));
+	unsigned n_evaluators = (unsigned)n_workers;
+	if (local_context != NULL) {
+		init_local_evaluator(&local, local_context, model_space, batch);
+		n_evaluators++;
+	}
+
+	TIME_STRUCT_INIT(timer);
+	TIME_STRUCT_INIT(phase);
+	TIME_START(timer);
+
+	DBG_MASTER("Master[%d]: Starting on demand work distribution...\n", process_id);
+
+	unsigned progress = 0;
+	if (print_progress) { fprint_progress_begin(out); }
+
+	while (pool.finish_ctr < n_tasks || pool.n_screening > 0 || dispatcher.n_searching > 0) {
+		unsigned task = 0;
+
+		while (true) {
+			preload_fresh_tasks(&pool);
+			if (advance_stalled(&pool)) continue;
+			if (pool.n_loaded == batch->n_datasets || next_pool_task(&pool, &task)) break;
+			load_next_dataset(&pool);
+		}
+		/* the last climbs ended, leaving out the remaining tasks */
+		if (pool.finish_ctr == n_tasks && pool.n_screening == 0 && dispatcher.n_searching == 0) break;
+
+		/* hand out tasks as long as there are ready models: idle workers first, then one chunk queued
+		 * ahead per worker, so it moves on to its next task without a round trip to the master */
+		while (next_pool_task(&pool, &task)) {
+			unsigned d    = dataset_of(batch, task / n_models);
+			int      slot = select_worker(&dispatcher, worker_datasets, d);
+			if (slot < 0) break;
+
+			provide_dataset(slot + 1, root_comm, batch, worker_datasets, d);
+
+			/* the ready tasks of the same dataset, one unless the models are short */
+			unsigned    size = guided_chunk_size(&pool.cost_models[task / n_models], pool.K[task % n_models],
+			                                     n_tasks + pool.n_refines - n_dispatched - pool.n_preloaded - pool.n_skipped,
+			                                     n_evaluators);
+			pltb_task_t tasks      [MAX_CHUNK_SIZE];
+			unsigned    ids        [MAX_CHUNK_SIZE];
+			double     *warm_states[MAX_CHUNK_SIZE];
+			unsigned    n_chunk = 0;
+			do {
+				unsigned origin = 0;
+				set_model(model_space, task % n_models);
+				tasks[n_chunk].matrix_index         = model_space->matrix_index;
+				tasks[n_chunk].free_parameter_count = model_space->free_parameter_count;
+				tasks[n_chunk].config_index         = task / n_models;
+				tasks[n_chunk].refine               = pool.refining[task];
+				tasks[n_chunk].warm_start           = select_start_state(model_space, config, task,
+				                                                         pool.refining, pool.evaluated, stats, &origin);
+				warm_states[n_chunk] = tasks[n_chunk].warm_start ? warm_state_of(batch, n_models, origin) : NULL;
+				pool.dispatched[task] = true;
+				order[n_dispatched++] = task;
+				ids[n_chunk++]        = task;
+
+				DBG_MASTER("Master[%d] -> Worker[%02d]: Matrix #%03u with K = %u of configuration %u\n",
+				           process_id, slot + 1, model_space->matrix_index,
+				           model_space->free_parameter_count, task / n_models);
+			} while (n_chunk < size
+			         && next_pool_task(&pool, &task)
+			         && dataset_of(batch, task / n_models) == d);
+
+			send_chunk(&dispatcher, slot, tasks, ids, n_chunk, warm_states, batch->datasets[d].warm_length);
+		}
+
+		/* the local evaluator takes the next model once all workers are busy */
+		if (local_idle && next_pool_task(&pool, &task)) {
+			unsigned origin = 0;
+			bool warm = select_start_state(model_space, config, task, pool.refining, pool.evaluated, stats, &origin);
+			pool.dispatched[task] = true;
+			order[n_dispatched++] = task;
+			local_task            = task;
+			local_idle            = false;
+
+			DBG_MASTER("Master[%d] -> Master[%d]: Matrix #%03u of configuration %u\n",
+			           process_id, process_id, task % n_models, task / n_models);
+
+			dispatch_local(&local, task / n_models, task % n_models,
+			               warm ? warm_state_of(batch, n_models, origin) : NULL,
+			               batch->datasets[dataset_of(batch, task / n_models)].warm_length, pool.refining[task]);
+		}
+
+		/* evaluation tail: let idle workers search the trees of the current leaders.
+		 * Once all models are evaluated the leaders are final, so they are worth
+		 * searching while waiting for the outstanding speculative searches. */
+		int slot;
+		while (config->speculative_tree_search
+				&& n_dispatched + pool.n_preloaded + pool.n_skipped == n_tasks + pool.n_refines
+				&& pool.n_screening == 0
+				&& (slot = idle_worker(&dispatcher)) >= 0
+				&& next_speculative_task(model_space, batch->n_configs, stats, pool.finished, searched, &task)) {
+			provide_dataset(slot + 1, root_comm, batch, worker_datasets, dataset_of(batch, task / n_models));
+			searched[task] = true;
+
+			DBG_MASTER("Master[%d] -> Worker[%02d]: Speculative tree search for matrix #%03u of configuration %u\n",
+			           process_id, slot + 1, task % n_models, task / n_models);
+
+			send_tree_search(&dispatcher, slot, task, absolute_model_index(model_space, task % n_models),
+			                 task / n_models);
+		}
+
+		/* the tasks finished by this round: results of several workers or the one of the local evaluator */
+		unsigned          done_tasks[n_workers];
+		pltb_model_stat_t done_stats[n_workers];
+		int               n_replies = 0;
+
+		/* wait for workers (or the local evaluator) to finish a task,
+		 * the speculative trees & local results are polled for */
+		bool local_finished = false;
+		bool newick         = false;
+		PHASE_START(phase);
+		if (local_context == NULL && dispatcher.n_searching == 0) {
+			n_replies = collect_results(&dispatcher, true);
+		} else {
+			const struct timespec interval = { 0, LOCAL_POLL_INTERVAL_NS };
+			while ((n_replies = collect_results(&dispatcher, false)) == 0) {
+				if (probe_tree(&dispatcher, &status)) {
+					newick = true;
+					break;
+				}
+				if (local_context != NULL && !local_idle && collect_local(&local, &done_stats[0],
+				                                 config->warm_start ? warm_state_of(batch, n_models, local_task) : NULL,
+				                                 batch->datasets[dataset_of(batch, local_task / n_models)].warm_length)) {
+					local_finished = true;
+					break;
+				}
+				nanosleep(&interval, NULL);
+			}
+		}
+		PHASE_END(config->profile, PHASE_WAIT, phase);
+
+		unsigned n_done = 0;
+		if (local_finished) {
+			done_tasks[n_done++] = local_task;
+			local_evaluated[local_task] = true;
+			local_idle = true;
+		} else if (newick) {
+			/* a (possibly already outdated) speculative tree */
+			char *tree;
+			speculative_trees[receive_tree(&dispatcher, &status, &tree)] = tree;
+			continue;
+		}
+		for (int r = 0; r < n_replies; r++) {
+			/* task-specific evaluation information, the optimized state follows */
+			unsigned t = result_task(&dispatcher, r);
+			receive_result(&dispatcher, r, &done_stats[n_done],
+			               config->warm_start ? warm_state_of(batch, n_models, t) : NULL,
+			               batch->datasets[dataset_of(batch, t / n_models)].warm_length);
+			done_tasks[n_done++] = t;
+		}
+
+		for (unsigned k = 0; k < n_done; k++) {
+			finish_task(&pool, done_tasks[k], done_stats[k]);
+			if (print_progress) { progress = fprint_progress_step(out, progress, pool.finish_ctr, n_tasks); }
+		}
+	}
+
+	TIME_END(timer);
+	if (local_context != NULL) {
+		destroy_local_evaluator(&local);
+	}
+
+	DBG_MASTER("Master[%d]: Distribution complete. Sending shutdown signals...\n", process_id);
+
+	destroy_dispatcher(&dispatcher);
+	for (int worker_id = 1; worker_id <= n_workers; worker_id++) {
+		DBG_MASTER("Master[%d] -> Worker[%02d]: Switch to reduction mode!\n", process_id, worker_id);
 		/* issue transfer of result to master (per reduce) */
-		MPI_Send(NULL, 0, mpi_task_type, status.MPI_SOURCE,
+		MPI_Send(NULL, 0, mpi_task_type, worker_id,
 		         STOP_TAG, root_comm);
 	}
-	if (print_progress) { fprint_progress_end(out); }
+	for (unsigned d = 0; d < batch->n_datasets; d++) {
+		free(batch->datasets[d].warm_states);
+		batch->datasets[d].warm_states = NULL;
+	}
+	if (print_progress) {
+		fprint_progress_end(out);
+
+		/* how well did the cost model predict the schedule? */
+		double *costs = malloc(sizeof(double) * n_orders);
+		for (unsigned i = 0; i < n_dispatched; i++) {
+			costs[i] = predict_cost(&pool.cost_models[order[i] / n_models], pool.K[order[i] % n_models]);
+		}
+		fprint_makespan(out, simulate_makespan(costs, n_dispatched, n_evaluators), TIME_REAL(timer));
+		free(costs);
+	}
 	DBG_MASTER("Master[%d]: Waiting for all workers to finish their work and fold their results...\n", process_id);
 
-	pltb_result_t result;
+	/* one result per configuration */
+	pltb_result_t *results = malloc(sizeof(pltb_result_t) * batch->n_configs);
 
 	/* * * *
 	 * Use the intercommunicator between the master communicator and the worker
@@ -154,94 +1290,246 @@ static void master(int process_id, int n_workers,
 	 * will reduce all workers results (their local maxima) to an aggregated result
 	 * (global maximum) which is received by only the root process.
 	 * * * */
-	MPI_Reduce(NULL, &result, n_workers, mpi_result_type,
+	PHASE_START(phase);
+	MPI_Reduce(NULL, results, (int)batch->n_configs, mpi_result_type,
 	           mpi_result_reduce_op, MPI_ROOT, inter_comm);
+	PHASE_END(config->profile, PHASE_REDUCE, phase);
 
-	/* all workers will die now */
+	/* the workers don't know about the models evaluated by the master, journaled or cached */
+	for (unsigned t = 0; t < n_tasks; t++) {
+		if (local_evaluated[t] || pool.preloaded[t]) {
+			merge_into_result(&results[t / n_models], &stats[t], t % n_models);
+		}
+	}
+	/* the workers merged the screening results of the contenders as well */
+	for (unsigned c = 0; pool.screening && c < batch->n_configs; c++) {
+		collect_result(model_space, &stats[c * n_models], &pool.finished[c * n_models], &results[c]);
+	}
 
+	/* all workers switch to tree search mode now */
 
-	fprint_eval_header(out);
-	for (unsigned i = 0; i < model_space->matrix_count; i++) {
-		fprint_eval_row(out, model_space, &stats[i]);
-	}
-	fprint_eval_summary(out, model_space, &stats, &result);
+	write_results(batch, model_space, stats, pool.climbs, pool.screening ? pool.refining : NULL, results);
 	DEBUG_PROCESS_STATISTICS_CLOSE_OUTPUT(out);
 
-	evaluate_result(model_space, &result, data, config);
+	distribute_tree_searches(n_workers, root_comm, model_space, batch, results, speculative_trees, worker_datasets);
+
+	/* discard the trees of beaten models */
+	for (unsigned t = 0; t < n_tasks; t++) {
+		free(speculative_trees[t]);
+	}
+	free(results);
+	free(speculative_trees);
+	free(searched);
+	free(local_evaluated);
+	free(order);
+	destroy_task_pool(&pool);
 }
 
+/**
+ * Conducts the tree search for an absolute model index and sends the tree to the master.
+ * @param seed_tree The ML tree to start from (@see search_tree), NULL => none
+ * @param reply_ml_tree Sends the ML tree as seed of further searches afterwards
+ */
+static void reply_tree_search(int master_id, MPI_Comm root_comm, unsigned matrix_index,
+		worker_alignment_t *alignment, pltb_config_t *config, char *start_tree, char *seed_tree, bool reply_ml_tree)
+{
+	model_space_t model_space;
+	init_default_model_space(&model_space);
+	set_model(&model_space, matrix_index);
+
+	pllAlignmentData *data = unpack_worker_alignment(alignment);
+
+	TIME_STRUCT_INIT(phase);
+	pltb_counter_sample_t counters;
+	sample_counters(&counters);
+	PHASE_START(phase);
+	char *ml_tree = NULL;
+	char *newick  = search_tree(model_space.matrix_repr, data, config, start_tree, seed_tree,
+			reply_ml_tree ? &ml_tree : NULL);
+	PHASE_END(config->profile, PHASE_TREE_SEARCH, phase);
+	add_tree_counters(config->profile, &counters);
+	MPI_Send(newick, (int)strlen(newick) + 1, MPI_CHAR, master_id, NEWICK_TAG, root_comm);
+	if (reply_ml_tree) {
+		MPI_Send(ml_tree, (int)strlen(ml_tree) + 1, MPI_CHAR, master_id, SEED_TAG, root_comm);
+		free(ml_tree);
+	}
+
+	free(newick);
+	pllAlignmentDataDestroy(data);
+	destroy_model_space(&model_space);
+}
+
+/**
+ * @param alignment The MSA, replaced as lazy batches hand out the datasets (none until the first one)
+ * @param context Built for the first configuration of the batch or not at all (lazy batches), switched as needed
+ */
 static void worker(int process_id, int master_id,
 			MPI_Comm root_comm, MPI_Comm inter_comm,
-			pllAlignmentData *data, pltb_config_t *config,
-			model_space_t *model_space)
+			worker_alignment_t *alignment,
+			batch_t *batch, model_space_t *model_space,
+			pltb_eval_context_t *context)
 {
 	MPI_Status status;
 
-	pltb_result_t    result;
-	pltb_task_t      task;
+	pltb_result_t    results[batch->n_configs];
+	pltb_task_t      chunk[MAX_CHUNK_SIZE];
+	int              chunk_size;
+	unsigned         context_config = context->inst != NULL ? 0 : NO_CONFIG;
+	pltb_profile_t  *profile        = batch->configs[0].profile;
+	TIME_STRUCT_INIT(phase);
 
-	for (unsigned i = 0; i < IC_MAX; i++) {
-		result.ic[i] = FLT_MAX;
+	for (unsigned c = 0; c < batch->n_configs; c++) {
+		for (unsigned i = 0; i < IC_MAX; i++) {
+			results[c].ic[i] = FLT_MAX;
+		}
 	}
 
-	TIME_STRUCT_INIT(timer);
 	pltb_model_stat_t stat;
 
+	unsigned warm_length = 0;
+	double  *warm_state  = NULL;
+	if (alignment->shape != NULL && batch->configs[0].warm_start) {
+		warm_length = warm_start_length(alignment->shape->sequenceCount);
+		warm_state  = malloc(sizeof(double) * warm_length);
+	}
+
 	while (true) {
-		/* receive task (or STOP command) from master */
-		MPI_Recv(&task, 1, mpi_task_type, master_id, MPI_ANY_TAG, root_comm, &status);
+		/* receive task (or STOP command or the next dataset) from master */
+		PHASE_START(phase);
+		MPI_Probe(master_id, MPI_ANY_TAG, root_comm, &status);
+		PHASE_END(profile, PHASE_WAIT, phase);
+
+		if (status.MPI_TAG == DATA_TAG) {
+			/* done with the previous dataset, the context is rebuilt by the next task */
+			if (context->inst != NULL) {
+				destroy_eval_context(context);
+			}
+			context_config = NO_CONFIG;
+			PHASE_START(phase);
+			receive_dataset(master_id, root_comm, batch, alignment);
+			PHASE_END(profile, PHASE_READ, phase);
+			if (batch->configs[0].warm_start) {
+				warm_length = warm_start_length(alignment->shape->sequenceCount);
+				warm_state  = realloc(warm_state, sizeof(double) * warm_length);
+			}
+			DBG_WORKER("Worker[%02d]: Received the next dataset\n", process_id);
+			continue;
+		}
+
+		/* a chunk of tasks (one unless the models are short), the master queues the next one meanwhile */
+		MPI_Get_count(&status, mpi_task_type, &chunk_size);
+		MPI_Recv(chunk, chunk_size, mpi_task_type, master_id, status.MPI_TAG, root_comm, &status);
 
 		if (status.MPI_TAG == STOP_TAG) break;
 
+		if (status.MPI_TAG == TREE_TAG) {
+			DBG_WORKER("Worker[%02d]: Received order to speculatively search the tree of matrix #%u\n",
+						process_id, chunk[0].matrix_index);
+			reply_tree_search(master_id, root_comm, chunk[0].matrix_index, alignment,
+			                  &batch->configs[chunk[0].config_index], batch->start_trees[chunk[0].config_index],
+			                  NULL, false);
+			continue;
+		}
+
 		assert(status.MPI_TAG == TASK_TAG);
-		DBG_WORKER("Worker[%02d]: Received order to process matrix #%u\n",
-					process_id, task.matrix_index);
+		for (int j = 0; j < chunk_size; j++) {
+			pltb_task_t *task = &chunk[j];
+			DBG_WORKER("Worker[%02d]: Received order to process matrix #%u of configuration %u\n",
+						process_id, task->matrix_index, task->config_index);
+
+			pltb_config_t *config = &batch->configs[task->config_index];
+			if (task->warm_start) {
+				MPI_Recv(warm_state, (int)warm_length, MPI_DOUBLE, master_id, WARM_TAG, root_comm, MPI_STATUS_IGNORE);
+			}
+
+			switch_worker_context(context, &context_config, task->config_index, batch, alignment, profile);
+			evaluate_model(context, model_space, alignment->shape, config, task->matrix_index,
+			               task->warm_start ? warm_state : NULL, task->refine, &stat, profile);
+			merge_into_result(&results[task->config_index], &stat, model_space->matrix_index);
+
+			/* reply with DONE tag and the meta information, per task */
+			MPI_Send(&stat, 1, mpi_model_stat_type, master_id, DONE_TAG, root_comm);
+
+			/* the master keeps the optimized state for the children of this model */
+			if (config->warm_start) {
+				save_warm_start(context, warm_state);
+				MPI_Send(warm_state, (int)warm_length, MPI_DOUBLE, master_id, WARM_TAG, root_comm);
+			}
+		}
+	}
+
+	free(warm_state);
 
-		set_model(model_space, task.matrix_index);
+	DBG_WORKER("Worker[%02d]: Stop signal received. Proceeding with reduction process...\n", process_id);
 
-		partitionList *parts = init_partitions(data, config->base_freq_kind);
+	PHASE_START(phase);
+	MPI_Reduce(results, NULL, (int)batch->n_configs, mpi_result_type, mpi_result_reduce_op, master_id, inter_comm);
+	PHASE_END(profile, PHASE_REDUCE, phase);
 
-		pllInstance *inst = setup_instance(model_space->matrix_repr, &config->attr_model_eval, data, parts);
+	DBG_WORKER("Worker[%02d]: Result transmitted to reduction process.\n", process_id);
+}
 
-		/* initiate time measuring */
-		stat.matrix_index = task.matrix_index;
-		TIME_START(timer);
+/**
+ * @param alignment The MSA, replaced as lazy batches hand out the datasets
+ */
+static void tree_search_worker(int process_id, int master_id, MPI_Comm root_comm,
+		worker_alignment_t *alignment, batch_t *batch)
+{
+	(void)process_id; /* debug messages only */
 
-		/* the time intensive work.. */
-		optimize_model_parameters(inst, parts);
+	MPI_Status  status;
+	pltb_task_t task;
 
-		/* measure and store time */
-		TIME_END(timer);
-		stat.time_cpu  = TIME_CPU(timer);
-		stat.time_real = TIME_REAL(timer);
+	while (true) {
+		MPI_Probe(master_id, MPI_ANY_TAG, root_comm, &status);
 
-		stat.likelihood = inst->likelihood;
-		calculate_model_ICs(&stat, data, inst, model_space->free_parameter_count, config);
-		merge_into_result(&result, &stat, model_space->matrix_index);
+		if (status.MPI_TAG == DATA_TAG) {
+			receive_dataset(master_id, root_comm, batch, alignment);
+			continue;
+		}
 
-		/* clean up */
-		pllPartitionsDestroy(inst, &parts);
-		pllDestroyInstance(inst);
+		MPI_Recv(&task, 1, mpi_task_type, master_id, status.MPI_TAG, root_comm, &status);
 
-		/* reply with DONE tag and the meta information */
-		MPI_Send(&stat, 1, mpi_model_stat_type, master_id, DONE_TAG, root_comm);
-	}
+		if (status.MPI_TAG == STOP_TAG) break;
 
-	DBG_WORKER("Worker[%02d]: Stop signal received. Proceeding with reduction process...\n", process_id);
+		assert(status.MPI_TAG == TREE_TAG);
+		DBG_WORKER("Worker[%02d]: Received order to search the tree of matrix #%u\n",
+					process_id, task.matrix_index);
 
-	MPI_Reduce(&result, NULL, 1, mpi_result_type, mpi_result_reduce_op, master_id, inter_comm);
+		pltb_config_t *config = &batch->configs[task.config_index];
+		char *seed_tree = NULL;
+		if (config->seed_tree_searches) {
+			int length;
+			MPI_Probe(master_id, SEED_TAG, root_comm, &status);
+			MPI_Get_count(&status, MPI_CHAR, &length);
+			seed_tree = malloc((size_t)length);
+			MPI_Recv(seed_tree, length, MPI_CHAR, master_id, SEED_TAG, root_comm, MPI_STATUS_IGNORE);
+		}
 
-	DBG_WORKER("Worker[%02d]: Result transmitted to reduction process. Exiting.\n", process_id);
+		/* an empty seed: the first search of the configuration */
+		bool first = seed_tree != NULL && seed_tree[0] == '\0';
+		reply_tree_search(master_id, root_comm, task.matrix_index, alignment, config,
+		                  batch->start_trees[task.config_index], first ? NULL : seed_tree, first);
+		free(seed_tree);
+	}
+
+	DBG_WORKER("Worker[%02d]: Stop signal received. Exiting.\n", process_id);
 }
 
 /**
  * The core function of pltb.
- * @param dataset_file the file containing the sequences
+ * @param dataset_files The files containing the sequences, several ones are evaluated as one batch
+ * @param configs The configurations evaluated as one pool of tasks, the ones of a dataset after another
+ *                (n_configs / n_datasets each, random seeds & base frequencies differ only)
  */
-int run_master_worker(int process_id, MPI_Comm root_comm, char *dataset_file,
-		pltb_config_t *config, model_space_t *model_space, bool print_progress)
+int run_master_worker(int process_id, MPI_Comm root_comm, char **dataset_files, unsigned n_datasets,
+		pltb_config_t *configs, unsigned n_configs, model_space_t *model_space, bool print_progress)
 {
-	assert(strcmp(dataset_file, "") != 0);
+	/* the settings below are the same for all configurations */
+	pltb_config_t *config = &configs[0];
+	/* journals cover a single configuration */
+	assert(n_configs == 1 || config->journal_file == NULL);
+	assert(n_datasets > 0 && n_configs % n_datasets == 0);
 
 	const int master_id = 0;
 
@@ -256,7 +1544,7 @@ int run_master_worker(int process_id, MPI_Comm root_comm, char *dataset_file,
 		return 1;
 	}
 
-	if (n_processes - (int)model_space->matrix_count > 1) {
+	if (n_processes - (int)(n_configs * model_space->matrix_count) > 1) {
 		if (process_id == master_id) {
 			printf("Too many processes attached. Quitting.\n");
 		}
@@ -265,6 +1553,47 @@ int run_master_worker(int process_id, MPI_Comm root_comm, char *dataset_file,
 
 	n_workers = n_processes - 1;
 
+	dataset_t *datasets    = calloc(n_datasets, sizeof(dataset_t));
+	char     **start_trees = calloc(n_configs, sizeof(char*));
+	for (unsigned d = 0; d < n_datasets; d++) {
+		assert(strcmp(dataset_files[d], "") != 0);
+		datasets[d].file = dataset_files[d];
+	}
+	batch_t batch = { configs, start_trees, n_configs, datasets, n_datasets, n_configs / n_datasets, n_datasets > 1 };
+
+	/* only the master touches the file system, the workers get a packed copy.
+	 * The first dataset is read up front, which validates the cache directory for all of them. */
+	pltb_cache_t  *caches = NULL;
+	pltb_journal_t journal;
+	int preload_error = 0;
+	if (process_id == master_id) {
+		if (config->cache_dir != NULL) {
+			caches = malloc(sizeof(pltb_cache_t) * n_configs);
+		}
+		/* the caches of all configurations are opened with their dataset, the journal right away */
+		preload_error = load_dataset(&batch, 0, caches, model_space);
+		if (!preload_error && config->journal_file != NULL) {
+			preload_error = open_journal(&journal, config->journal_file,
+					datasets[0].fingerprint, fingerprint_config(config), model_space);
+		}
+	}
+	MPI_Bcast(&preload_error, 1, MPI_INT, master_id, root_comm);
+	if (preload_error) {
+		if (process_id == master_id && datasets[0].data != NULL) {
+			pllAlignmentDataDestroy(datasets[0].data);
+			if (batch.lazy) {
+				destroy_packed_alignment(&datasets[0].packed);
+			}
+		}
+		for (unsigned c = 0; c < n_configs; c++) {
+			free(start_trees[c]);
+		}
+		free(start_trees);
+		free(datasets);
+		free(caches);
+		return 1;
+	}
+
 	MPI_Comm local_comm;
 	MPI_Comm inter_comm;
 
@@ -304,17 +1633,107 @@ int run_master_worker(int process_id, MPI_Comm root_comm, char *dataset_file,
 	 * allocating operation => free op after use */
 	MPI_Op_create(result_reduce, true, &mpi_result_reduce_op);
 
-	pllAlignmentData *data  = read_alignment_data(dataset_file);
+	/* a single dataset is distributed right away, the ones of a batch on demand */
+	pllAlignmentData       *data   = process_id == master_id ? datasets[0].data : NULL;
+	pltb_packed_alignment_t packed = { NULL, 0 };
+	pltb_shared_alignment_t shared_alignment;
+	bool shared = false;
+	TIME_STRUCT_INIT(phase);
+	if (!batch.lazy) {
+		PHASE_START(phase);
+		shared = config->shared_alignment
+			&& init_shared_alignment(&shared_alignment, data, master_id, root_comm) == MPI_SUCCESS;
+		if (!shared) {
+			broadcast_alignment_data(data, &packed, master_id, root_comm);
+		}
+		if (process_id != master_id) {
+			PHASE_END(config->profile, PHASE_READ, phase);
+		}
+
+		/* the starting tree is the same for all models of a configuration: computed once by the master */
+		for (unsigned c = 0; c < n_configs; c++) {
+			unsigned owner = start_tree_owner(configs, 0, c);
+			if (owner < c) {
+				start_trees[c] = strdup(start_trees[owner]);
+				continue;
+			}
+			PHASE_START(phase);
+			if (process_id == master_id) {
+				start_trees[c] = compute_start_tree(&configs[c].attr_model_eval, data, configs[c].base_freq_kind);
+			}
+			broadcast_string(&start_trees[c], master_id, root_comm);
+			PHASE_END(config->profile, PHASE_START_TREE, phase);
+		}
+	}
 
 	if (process_id == master_id) {
 		// master
-		master(process_id, n_workers, root_comm, inter_comm, data, config, model_space, print_progress);
+		int thread_level;
+		MPI_Query_thread(&thread_level);
+		if (config->master_evaluates && thread_level < MPI_THREAD_FUNNELED) {
+			printf("MPI library lacks thread support, the master won't evaluate models.\n");
+		}
+		if (config->master_evaluates && thread_level >= MPI_THREAD_FUNNELED) {
+			/* evaluated by a second thread, only this one talks to MPI */
+			pltb_eval_context_t context;
+			PHASE_START(phase);
+			init_eval_context(&context, &config->attr_model_eval, datasets[0].data, config->base_freq_kind,
+			                  config->rate_het, start_trees[0]);
+			PHASE_END(config->profile, PHASE_SETUP, phase);
+			master(process_id, n_workers, root_comm, inter_comm, &batch, model_space, &context,
+			       config->journal_file != NULL ? &journal : NULL, caches, print_progress);
+			destroy_eval_context(&context);
+		} else {
+			master(process_id, n_workers, root_comm, inter_comm, &batch, model_space, NULL,
+			       config->journal_file != NULL ? &journal : NULL, caches, print_progress);
+		}
+		if (config->journal_file != NULL) {
+			close_journal(&journal);
+		}
+		for (unsigned d = 0; d < n_datasets; d++) {
+			if (datasets[d].data != NULL) {
+				pllAlignmentDataDestroy(datasets[d].data);
+			}
+			if (batch.lazy && datasets[d].packed.bytes != NULL) {
+				destroy_packed_alignment(&datasets[d].packed);
+			}
+		}
 	} else {
-		// worker
-		worker(process_id, master_id, root_comm, inter_comm, data, config, model_space);
+		// worker: one instance for all tasks of a configuration, built on demand for the ones of a batch
+		worker_alignment_t  alignment;
+		pltb_eval_context_t context;
+		context.inst = NULL;
+		if (shared) {
+			map_worker_alignment(&alignment, &shared_alignment);
+		} else {
+			init_worker_alignment(&alignment, &packed);
+		}
+		if (!batch.lazy) {
+			PHASE_START(phase);
+			data = unpack_worker_alignment(&alignment);
+			init_eval_context(&context, &config->attr_model_eval, data, config->base_freq_kind,
+			                  config->rate_het, start_trees[0]);
+			adopt_instance_shape(&alignment, data);
+			pllAlignmentDataDestroy(data);
+			PHASE_END(config->profile, PHASE_SETUP, phase);
+		}
+		worker(process_id, master_id, root_comm, inter_comm, &alignment, &batch, model_space, &context);
+		if (context.inst != NULL) {
+			destroy_eval_context(&context);
+		}
+		tree_search_worker(process_id, master_id, root_comm, &alignment, &batch);
+		destroy_worker_alignment(&alignment);
 	}
 
-	pllAlignmentDataDestroy(data);
+	for (unsigned c = 0; c < n_configs; c++) {
+		free(start_trees[c]);
+	}
+	free(start_trees);
+	free(datasets);
+	free(caches);
+	if (shared) {
+		destroy_shared_alignment(&shared_alignment);
+	}
 
 	MPI_Type_free(&mpi_task_type);
 	MPI_Type_free(&mpi_result_type);
@@ -44,4 +44,4 @@
 	#define DBG_MASTER(fmt, p, ...)
 #endif
 
-int run_master_worker( int process_id, MPI_Comm root_comm, char *dataset_file, pltb_config_t *config, model_space_t *model_space, bool print_progress );
+int run_master_worker( int process_id, MPI_Comm root_comm, char **dataset_files, unsigned n_datasets, pltb_config_t *configs, unsigned n_configs, model_space_t *model_space, bool print_progress );
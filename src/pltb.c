@@ -25,8 +25,14 @@
 #include <stddef.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
+#include "alignment.h"
+#include "cache.h"
+#include "journal.h"
 #include "pltb.h"
+#include "pltb_frontend.h"
+#include "sink.h"
 
 void configure_attr_defaults( pltb_config_t *config )
 {
@@ -53,9 +59,37 @@ pllInstance *init_instance( pllInstanceAttr *attr )
 pllAlignmentData *read_alignment_data( char *dataset_file )
 {
 	assert(access(dataset_file, R_OK ) != -1);
+	pltb_alignment_file_header_t header;
+	if (read_alignment_file_header(dataset_file, &header)) {
+		return map_alignment_file(dataset_file);
+	}
 	return pllParseAlignmentFile(PLL_FORMAT_PHYLIP, dataset_file);
 }
 
+int convert_alignment_file( char *dataset_file, char *binary_file )
+{
+	pllAlignmentData *data = read_alignment_data(dataset_file);
+	if (data == NULL) {
+		fprintf(stderr, "Can't read alignment %s.\n", dataset_file);
+		return 1;
+	}
+	pllAlignmentData *patterns = compress_alignment_patterns(data);
+	uint64_t fingerprint = fingerprint_alignment(patterns);
+
+	pltb_packed_alignment_t packed;
+	pack_alignment_data(patterns, &packed);
+	int error = write_alignment_file(binary_file, &packed, fingerprint);
+	if (!error) {
+		printf("%s: %d taxa, %d sites, %d patterns, fingerprint %016" PRIx64 "\n",
+		       binary_file, patterns->sequenceCount, data->sequenceLength, patterns->sequenceLength, fingerprint);
+	}
+
+	destroy_packed_alignment(&packed);
+	pllAlignmentDataDestroy(patterns);
+	pllAlignmentDataDestroy(data);
+	return error;
+}
+
 partitionList *init_partitions( pllAlignmentData *data, pltb_base_freq_t base_freq_kind ) {
 	//  DNAX => optimize base frequencies
 	//  DNA  => empirical base frequencies
@@ -70,7 +104,7 @@ partitionList *init_partitions( pllAlignmentData *data, pltb_base_freq_t base_fr
 			prefix = "DNAX";
 			break;
 		case EQUAL:
-			/* use empirical for now */
+			/* fixed to 1/4 each once the model is initialized (@see fix_model_variant) */
 			prefix = "DNA";
 			break;
 	}
@@ -83,12 +117,6 @@ partitionList *init_partitions( pllAlignmentData *data, pltb_base_freq_t base_fr
 
 	partitionList *parts = pllPartitionsCommit(queue, data);
 
-	if (base_freq_kind == EQUAL) {
-		double equal_frequencies[] = {0.25, 0.25, 0.25, 0.25};
-		memcpy(parts->partitionData[0]->frequencies, &equal_frequencies, sizeof(double) * 4);
-		parts->dirty = PLL_TRUE;
-	}
-
 	pllQueuePartitionsDestroy(&queue);
 	return parts;
 }
@@ -97,33 +125,188 @@ void prepare_tree_string( pllInstance *inst, partitionList *parts ) {
 	pllTreeToNewick(inst->tree_string, inst, parts, inst->start->back, PLL_TRUE, PLL_FALSE, 0, 0, 0, PLL_SUMMARIZE_LH, 0,0);
 }
 
-pllInstance *setup_instance( char *matrix, pllInstanceAttr *attr, pllAlignmentData *alignment_data, partitionList *parts )
+/* pllInitModel sets empirical frequencies & an optimized alpha, the other variants are fixed afterwards */
+static void fix_model_variant( pllInstance *inst, partitionList *parts, pltb_base_freq_t base_freq_kind, pltb_rate_het_t rate_het )
+{
+	if (base_freq_kind == EQUAL) {
+		double equal_frequencies[] = {0.25, 0.25, 0.25, 0.25};
+		pllSetFixedBaseFrequencies(equal_frequencies, 4, 0, parts, inst);
+	}
+	if (rate_het == RATE_FLAT_GAMMA) {
+		pllSetFixedAlpha(PLL_ALPHA_MAX, 0, parts, inst);
+	}
+}
+
+static pllInstance *create_instance( pllInstanceAttr *attr, pllAlignmentData *alignment_data, partitionList *parts,
+		pltb_base_freq_t base_freq_kind, pltb_rate_het_t rate_het, char *start_tree )
+{
+	pllInstance *inst = init_instance(attr);
+	assert(inst != NULL);
+	if (start_tree != NULL) {
+		pllNewickTree *newick = pllNewickParseString(start_tree);
+		assert(newick != NULL);
+		/* default branch lengths, as for the parsimony tree */
+		pllTreeInitTopologyNewick(inst, newick, PLL_TRUE);
+		pllNewickParseDestroy(&newick);
+		pllLoadAlignment(inst, alignment_data, parts);
+	} else {
+		pllTreeInitTopologyForAlignment(inst, alignment_data);
+		pllLoadAlignment(inst, alignment_data, parts);
+		pllComputeRandomizedStepwiseAdditionParsimonyTree(inst, parts);
+	}
+	pllInitModel(inst, parts);
+	fix_model_variant(inst, parts, base_freq_kind, rate_het);
+	return inst;
+}
+
+char *compute_start_tree( pllInstanceAttr *attr, pllAlignmentData *data, pltb_base_freq_t base_freq_kind )
 {
+	partitionList *parts = init_partitions(data, base_freq_kind);
 	pllInstance *inst = init_instance(attr);
 	assert(inst != NULL);
-	pllTreeInitTopologyForAlignment(inst, alignment_data);
-	pllLoadAlignment(inst, alignment_data, parts);
+	pllTreeInitTopologyForAlignment(inst, data);
+	pllLoadAlignment(inst, data, parts);
 	pllComputeRandomizedStepwiseAdditionParsimonyTree(inst, parts);
+
+	pllTreeToNewick(inst->tree_string, inst, parts, inst->start->back, PLL_FALSE, PLL_TRUE, 0, 0, 0, PLL_SUMMARIZE_LH, 0, 0);
+	/* strip trailing newline */
+	inst->tree_string[strcspn(inst->tree_string, "\n")] = '\0';
+	char *start_tree = strdup(inst->tree_string);
+
+	pllPartitionsDestroy(inst, &parts);
+	pllDestroyInstance(inst);
+	return start_tree;
+}
+
+unsigned start_tree_owner( pltb_config_t *configs, unsigned first, unsigned c )
+{
+	while (configs[first].attr_model_eval.randomNumberSeed != configs[c].attr_model_eval.randomNumberSeed) {
+		first++;
+	}
+	return first;
+}
+
+void compute_start_trees( pltb_config_t *configs, unsigned n_configs, pllAlignmentData *data, char **start_trees )
+{
+	TIME_STRUCT_INIT(phase);
+	for (unsigned c = 0; c < n_configs; c++) {
+		unsigned owner = start_tree_owner(configs, 0, c);
+		if (owner < c) {
+			start_trees[c] = strdup(start_trees[owner]);
+			continue;
+		}
+		PHASE_START(phase);
+		start_trees[c] = compute_start_tree(&configs[c].attr_model_eval, data, configs[c].base_freq_kind);
+		PHASE_END(configs[c].profile, PHASE_START_TREE, phase);
+	}
+}
+
+int init_dataset( pltb_dataset_t *dataset, char *dataset_file, pltb_config_t *configs, unsigned n_configs )
+{
+	TIME_STRUCT_INIT(phase);
+	PHASE_START(phase);
+	dataset->data = read_alignment_data(dataset_file);
+	PHASE_END(configs[0].profile, PHASE_READ, phase);
+	if (dataset->data == NULL) {
+		return 1;
+	}
+	dataset->fingerprint = fingerprint_dataset(dataset_file, dataset->data);
+	dataset->n_configs   = n_configs;
+	dataset->start_trees = malloc(sizeof(char*) * n_configs);
+	compute_start_trees(configs, n_configs, dataset->data, dataset->start_trees);
+	return 0;
+}
+
+void destroy_dataset( pltb_dataset_t *dataset )
+{
+	for (unsigned c = 0; c < dataset->n_configs; c++) {
+		free(dataset->start_trees[c]);
+	}
+	free(dataset->start_trees);
+	pllAlignmentDataDestroy(dataset->data);
+	dataset->data = NULL;
+}
+
+pllInstance *setup_instance( char *matrix, pllInstanceAttr *attr, pllAlignmentData *alignment_data, partitionList *parts,
+		pltb_base_freq_t base_freq_kind, pltb_rate_het_t rate_het, char *start_tree )
+{
+	pllInstance *inst = create_instance(attr, alignment_data, parts, base_freq_kind, rate_het, start_tree);
+	pllSetSubstitutionRateMatrixSymmetries(matrix, parts, 0);
+	return inst;
+}
+
+/**
+ * Like setup_instance, but keeps the branch lengths of the given tree.
+ * @return NULL iff the tree doesn't fit the alignment, parts are unused then
+ */
+static pllInstance *setup_seeded_instance( char *matrix, pllInstanceAttr *attr, pllAlignmentData *alignment_data,
+		partitionList *parts, pltb_base_freq_t base_freq_kind, pltb_rate_het_t rate_het, char *seed_tree )
+{
+	pllNewickTree *newick = pllNewickParseString(seed_tree);
+	if (newick == NULL) {
+		return NULL;
+	}
+	if (!pllValidateNewick(newick) || newick->tips != alignment_data->sequenceCount) {
+		pllNewickParseDestroy(&newick);
+		return NULL;
+	}
+	pllInstance *inst = init_instance(attr);
+	assert(inst != NULL);
+	pllTreeInitTopologyNewick(inst, newick, PLL_FALSE);
+	pllNewickParseDestroy(&newick);
+	/* the taxon names of the tree have to match the ones of the alignment */
+	if (!pllLoadAlignment(inst, alignment_data, parts)) {
+		pllDestroyInstance(inst);
+		return NULL;
+	}
 	pllInitModel(inst, parts);
+	fix_model_variant(inst, parts, base_freq_kind, rate_het);
 	pllSetSubstitutionRateMatrixSymmetries(matrix, parts, 0);
 	return inst;
 }
 
-void calculate_model_ICs(pltb_model_stat_t *stat, pllAlignmentData* data, pllInstance* inst,
+void calculate_model_ICs(pltb_model_stat_t *stat, pllAlignmentData* data,
 		unsigned model_param_count, pltb_config_t* config)
 {
 	unsigned n_branches = (unsigned) data->sequenceCount * 2 - 3;
-	switch (config->base_freq_kind) {
-		default:
-			/* TODO error? */
-		case EMPIRICAL:
-		case EQUAL:
-			calculate_ICs(&stat->ic[0], data, inst, model_param_count + 1 + n_branches);
-			break;
-		case OPTIMIZED:
-			calculate_ICs(&stat->ic[0], data, inst, model_param_count + 4 + n_branches);
-			break;
+	calculate_ICs(&stat->ic[0], data, stat->likelihood, model_param_count + count_variant_parameters(config) + n_branches);
+}
+
+unsigned count_variant_parameters( pltb_config_t *config )
+{
+	/* alpha, 3 base frequencies (4th frequency = sum - 1) */
+	unsigned count = config->rate_het == RATE_GAMMA ? 1 : 0;
+	if (config->base_freq_kind == OPTIMIZED) {
+		count += 3;
+	}
+	return count;
+}
+
+const char *base_freq_name( pltb_base_freq_t base_freq_kind )
+{
+	return base_freq_kind == OPTIMIZED ? "optimized" : base_freq_kind == EQUAL ? "equal" : "empirical";
+}
+
+const char *rate_het_name( pltb_rate_het_t rate_het )
+{
+	return rate_het == RATE_FLAT_GAMMA ? "flat-gamma" : "gamma";
+}
+
+bool is_approximate_variant( pltb_config_t *config )
+{
+	return config->rate_het == RATE_FLAT_GAMMA;
+}
+
+unsigned select_joint_variant( pltb_config_t *variants, unsigned n_variants, IC criterion )
+{
+	unsigned best = n_variants;
+	for (unsigned v = 0; v < n_variants; v++) {
+		if (is_approximate_variant(&variants[v])) continue;
+		if (best == n_variants || variants[v].selection.ic[criterion] < variants[best].selection.ic[criterion]) {
+			best = v;
+		}
 	}
+	return best;
 }
 
 void merge_into_result( pltb_result_t *result, pltb_model_stat_t *stat, unsigned index )
@@ -136,12 +319,261 @@ void merge_into_result( pltb_result_t *result, pltb_model_stat_t *stat, unsigned
 	}
 }
 
+bool preload_model( pltb_config_t *config, model_space_t *model_space, pllAlignmentData *data,
+		struct pltb_journal *journal, struct pltb_cache *cache, pltb_model_stat_t *stat,
+		pltb_result_t *result, FILE *out )
+{
+	unsigned index     = model_space->matrix_index;
+	bool     screening = config->screen_epsilon > 0;
+	if (journal != NULL && journal->journaled[index]) {
+		*stat = journal->stats[index];
+	} else if (cache != NULL && lookup_cache(cache, index, stat)) {
+		calculate_model_ICs(stat, data, model_space->free_parameter_count, config);
+	} else {
+		return false;
+	}
+	if (result != NULL) {
+		merge_into_result(result, stat, index);
+	}
+	if (config->sink != NULL) {
+		sink_model(config->sink, config, model_space->matrix_repr_short, model_space->K, stat,
+		           screening ? "screening" : "full", true);
+	}
+	if (out != NULL && !screening) {
+		fprint_eval_row(out, model_space, stat);
+	}
+	return true;
+}
+
 void tree_search( pllInstance *inst, partitionList *parts )
 {
 	pllRaxmlSearchAlgorithm(inst, parts, PLL_TRUE);
 }
 
-void optimize_model_parameters( pllInstance *inst, partitionList *parts )
+char *search_tree( char *matrix, pllAlignmentData *data, pltb_config_t *config, char *start_tree,
+		char *seed_tree, char **ml_tree )
+{
+	/* the parsimony tree depends on the random seed only */
+	if (config->attr_tree_search.randomNumberSeed != config->attr_model_eval.randomNumberSeed) {
+		start_tree = NULL;
+	}
+
+	partitionList *parts = init_partitions(data, config->base_freq_kind);
+	pllInstance *inst = NULL;
+	if (seed_tree != NULL) {
+		inst = setup_seeded_instance(matrix, &config->attr_tree_search, data, parts,
+				config->base_freq_kind, config->rate_het, seed_tree);
+	}
+	if (inst == NULL) {
+		inst = setup_instance(matrix, &config->attr_tree_search, data, parts,
+				config->base_freq_kind, config->rate_het, start_tree);
+	}
+	tree_search(inst, parts);
+	if (ml_tree != NULL) {
+		/* names instead of tip numbers to be read by setup_seeded_instance */
+		pllTreeToNewick(inst->tree_string, inst, parts, inst->start->back, PLL_TRUE, PLL_TRUE, 0, 0, 0, PLL_SUMMARIZE_LH, 0, 0);
+		inst->tree_string[strcspn(inst->tree_string, "\n")] = '\0';
+		*ml_tree = strdup(inst->tree_string);
+	}
+	prepare_tree_string(inst, parts);
+	char *newick = strdup(inst->tree_string);
+
+	pllPartitionsDestroy(inst, &parts);
+	pllDestroyInstance(inst);
+	return newick;
+}
+
+void optimize_model_parameters( pllInstance *inst, partitionList *parts, double epsilon )
+{
+	pllOptimizeModelParameters(inst, parts, epsilon);
+}
+
+unsigned count_branch_lengths( int n_tips )
+{
+	/* one node record per tip, three per inner node */
+	return (unsigned)(n_tips + 3 * (n_tips - 2));
+}
+
+/* single partition => only z[0] is in use */
+static void copy_branch_lengths( pllInstance *inst, double *branch_lengths, bool save )
+{
+	unsigned k = 0;
+	for (int i = 1; i <= 2 * inst->mxtips - 2; i++) {
+		nodeptr p = inst->nodep[i];
+		do {
+			if (save) {
+				branch_lengths[k++] = p->z[0];
+			} else {
+				p->z[0] = branch_lengths[k++];
+			}
+			p = p->next;
+		} while (p != NULL && p != inst->nodep[i]);
+	}
+	assert(k == count_branch_lengths(inst->mxtips));
+}
+
+void save_branch_lengths( pllInstance *inst, double *branch_lengths )
 {
-	pllOptimizeModelParameters(inst, parts, inst->likelihoodEpsilon);
+	copy_branch_lengths(inst, branch_lengths, true);
+}
+
+void restore_branch_lengths( pllInstance *inst, double *branch_lengths )
+{
+	copy_branch_lengths(inst, branch_lengths, false);
+}
+
+void save_model_params( partitionList *parts, pltb_model_params_t *params )
+{
+	pInfo *partition = parts->partitionData[0];
+	memcpy(params->substitution_rates, partition->substRates, sizeof(params->substitution_rates));
+	memcpy(params->frequencies, partition->frequencies, sizeof(params->frequencies));
+	memcpy(params->freq_exponents, partition->freqExponents, sizeof(params->freq_exponents));
+	params->alpha = partition->alpha;
+}
+
+void restore_model_params( pllInstance *inst, partitionList *parts, pltb_model_params_t *params )
+{
+	pInfo *partition = parts->partitionData[0];
+	pllBoolean optimize_frequencies = partition->optimizeBaseFrequencies;
+	pllBoolean optimize_alpha       = partition->optimizeAlphaParameter;
+
+	/* the setters take care of eigenvalues, gamma categories and pthreads propagation,
+	 * but mark the respective parameters as fixed afterwards */
+	memcpy(partition->freqExponents, params->freq_exponents, sizeof(params->freq_exponents));
+	pllSetFixedBaseFrequencies(params->frequencies, 4, 0, parts, inst);
+	pllSetFixedSubstitutionMatrix(params->substitution_rates, 6, 0, parts, inst);
+	pllSetFixedAlpha(params->alpha, 0, parts, inst);
+
+	partition->optimizeBaseFrequencies   = optimize_frequencies;
+	partition->optimizeSubstitutionRates = PLL_TRUE;
+	partition->optimizeAlphaParameter    = optimize_alpha;
+}
+
+void init_eval_context( pltb_eval_context_t *context, pllInstanceAttr *attr, pllAlignmentData *data,
+		pltb_base_freq_t base_freq_kind, pltb_rate_het_t rate_het, char *start_tree )
+{
+	context->parts = init_partitions(data, base_freq_kind);
+	context->inst  = create_instance(attr, data, context->parts, base_freq_kind, rate_het, start_tree);
+	save_model_params(context->parts, &context->initial_params);
+	context->initial_branch_lengths = malloc(sizeof(double) * count_branch_lengths(context->inst->mxtips));
+	save_branch_lengths(context->inst, context->initial_branch_lengths);
+}
+
+static void load_eval_context( pltb_eval_context_t *context, char *matrix,
+		pltb_model_params_t *params, double *branch_lengths )
+{
+	restore_model_params(context->inst, context->parts, params);
+	restore_branch_lengths(context->inst, branch_lengths);
+	pllSetSubstitutionRateMatrixSymmetries(matrix, context->parts, 0);
+	/* branch lengths changed => full traversal */
+	pllEvaluateLikelihood(context->inst, context->parts, context->inst->start, PLL_TRUE, PLL_FALSE);
+}
+
+void reset_eval_context( pltb_eval_context_t *context, char *matrix )
+{
+	load_eval_context(context, matrix, &context->initial_params, context->initial_branch_lengths);
+}
+
+/* pltb_model_params_t consists of doubles only */
+#define MODEL_PARAMS_LENGTH (sizeof(pltb_model_params_t) / sizeof(double))
+
+unsigned warm_start_length( int n_tips )
+{
+	return (unsigned)MODEL_PARAMS_LENGTH + count_branch_lengths(n_tips);
+}
+
+void save_warm_start( pltb_eval_context_t *context, double *state )
+{
+	pltb_model_params_t params;
+	save_model_params(context->parts, &params);
+	memcpy(state, &params, sizeof(params));
+	save_branch_lengths(context->inst, &state[MODEL_PARAMS_LENGTH]);
+}
+
+void warm_start_eval_context( pltb_eval_context_t *context, char *matrix, double *state )
+{
+	pltb_model_params_t params;
+	memcpy(&params, state, sizeof(params));
+	load_eval_context(context, matrix, &params, &state[MODEL_PARAMS_LENGTH]);
+}
+
+bool select_warm_start_parent( model_space_t *model_space, unsigned index, bool *evaluated,
+		pltb_model_stat_t *stats, unsigned *parent )
+{
+	unsigned parents[MAX_PARENT_MODELS];
+	unsigned n_parents = parent_models(model_space, index, parents);
+	bool found = false;
+	for (unsigned i = 0; i < n_parents; i++) {
+		if (evaluated[parents[i]] && (!found || stats[parents[i]].likelihood > stats[*parent].likelihood)) {
+			*parent = parents[i];
+			found = true;
+		}
+	}
+	return found;
+}
+
+void destroy_eval_context( pltb_eval_context_t *context )
+{
+	free(context->initial_branch_lengths);
+	context->initial_branch_lengths = NULL;
+	pllPartitionsDestroy(context->inst, &context->parts);
+	pllDestroyInstance(context->inst);
+	context->inst = NULL;
+}
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t fnv1a( uint64_t hash, const void *bytes, size_t size )
+{
+	const unsigned char *p = bytes;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+uint64_t fingerprint_alignment( pllAlignmentData *data )
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	hash = fnv1a(hash, &data->sequenceCount, sizeof(data->sequenceCount));
+	hash = fnv1a(hash, &data->sequenceLength, sizeof(data->sequenceLength));
+	for (int i = 1; i <= data->sequenceCount; i++) {
+		hash = fnv1a(hash, data->sequenceLabels[i], strlen(data->sequenceLabels[i]) + 1);
+		hash = fnv1a(hash, data->sequenceData[i], (size_t)data->sequenceLength);
+	}
+	hash = fnv1a(hash, data->siteWeights, sizeof(int) * (size_t)data->sequenceLength);
+	return hash;
+}
+
+uint64_t fingerprint_dataset( char *dataset_file, pllAlignmentData *data )
+{
+	pltb_alignment_file_header_t header;
+	if (read_alignment_file_header(dataset_file, &header)) {
+		return header.fingerprint;
+	}
+	return fingerprint_alignment(data);
+}
+
+uint64_t fingerprint_config( pltb_config_t *config )
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	pllInstanceAttr *attr = &config->attr_model_eval;
+	hash = fnv1a(hash, &config->base_freq_kind, sizeof(config->base_freq_kind));
+	hash = fnv1a(hash, &config->warm_start, sizeof(config->warm_start));
+	hash = fnv1a(hash, &attr->rateHetModel, sizeof(attr->rateHetModel));
+	hash = fnv1a(hash, &attr->fastScaling, sizeof(attr->fastScaling));
+	hash = fnv1a(hash, &attr->saveMemory, sizeof(attr->saveMemory));
+	hash = fnv1a(hash, &attr->useRecom, sizeof(attr->useRecom));
+	hash = fnv1a(hash, &attr->randomNumberSeed, sizeof(attr->randomNumberSeed));
+	/* screening results differ from full precision ones, the fingerprints without screening stay as they are */
+	if (config->screen_epsilon > 0) {
+		hash = fnv1a(hash, &config->screen_epsilon, sizeof(config->screen_epsilon));
+	}
+	/* likewise for the variants without gamma rates */
+	if (config->rate_het != RATE_GAMMA) {
+		hash = fnv1a(hash, &config->rate_het, sizeof(config->rate_het));
+	}
+	return hash;
 }
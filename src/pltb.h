@@ -19,9 +19,13 @@
 #define PLTB_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <pll/pll.h>
 
 #include "ic.h"
+#include "models.h"
+#include "profile.h"
 
 typedef enum {
 	/* fixed empirical values (set by pll) */
@@ -32,6 +36,14 @@ typedef enum {
 	OPTIMIZED
 } pltb_base_freq_t;
 
+typedef enum {
+	/* +G: gamma distributed rates, implies 1 free parameter (alpha) */
+	RATE_GAMMA,
+	/* +G with alpha fixed at its maximum: the four gamma categories nearly coincide, approximating uniform
+	 * rates. PLL always builds the gamma categories, a single rate category is not available. */
+	RATE_FLAT_GAMMA
+} pltb_rate_het_t;
+
 typedef struct {
 	unsigned matrix_index[IC_MAX];
 	double   ic[IC_MAX];
@@ -45,15 +57,74 @@ typedef struct {
 	unsigned matrix_index;
 } pltb_model_stat_t;
 
+/* @see sink.h, journal.h & cache.h */
+struct pltb_sink;
+struct pltb_journal;
+struct pltb_cache;
+
 typedef struct {
 	/* implies a free parameter count of 3 */
 	unsigned *extra_models;
 	pllInstanceAttr attr_model_eval;
 	pllInstanceAttr attr_tree_search;
 	pltb_base_freq_t base_freq_kind;
+	pltb_rate_het_t rate_het;
 	unsigned n_extra_models;
+	/* start optimizations from the optimized parameters of a parent model */
+	bool warm_start;
+	/* evaluate the models along a greedy climb through the symmetry lattice only (@see pltb_climb_t) */
+	bool greedy_climb;
+	/* > 0 => two-stage screening with this loose convergence threshold (@see screen.h) */
+	double screen_epsilon;
+	/* IC units a screened model may trail the leader of a criterion and still be re-optimized */
+	double screen_margin;
+	/* MPI only: one copy of the MSA per node, mapped by all its processes */
+	bool shared_alignment;
+	/* MPI only: search the trees of the current leaders on idle workers during evaluation */
+	bool speculative_tree_search;
+	/* start the tree searches of the selected models from the ML tree of the first one (@see search_tree) */
+	bool seed_tree_searches;
+	/* MPI only: the master evaluates models next to distributing them */
+	bool master_evaluates;
+	/* without MPI: number of models evaluated concurrently (> 1 => threaded backend) */
+	unsigned eval_threads;
+	/* append-only record of the evaluated models to resume from, NULL => none */
+	char *journal_file;
+	/* directory of cached model evaluations shared by all runs, NULL => none */
+	char *cache_dir;
+	/* receives the evaluation table & trees of this configuration */
+	FILE *output;
+	/* file the output is appended to while in use (@see open_output), NULL => output as is */
+	char *output_file;
+	/* receives machine-readable records of the results as they come in, NULL => none */
+	struct pltb_sink *sink;
+	/* the dataset this configuration is evaluated on, identifies its records */
+	char *dataset_file;
+	/* set by the run: the selection per criterion, relative model indices (@see select_joint_variant) */
+	pltb_result_t selection;
+	/* accumulates the durations of the phases of this process, NULL => not profiled */
+	pltb_profile_t *profile;
 } pltb_config_t;
 
+/* the model parameters of the single partition we work on */
+typedef struct {
+	double substitution_rates[6];
+	double frequencies[4];
+	double freq_exponents[4];
+	double alpha;
+} pltb_model_params_t;
+
+/**
+ * A persistent pllInstance (and its partitions) reused for several model evaluations.
+ * Holds a snapshot of the starting state which is restored before every evaluation.
+ */
+typedef struct {
+	pllInstance   *inst;
+	partitionList *parts;
+	pltb_model_params_t initial_params;
+	double        *initial_branch_lengths;
+} pltb_eval_context_t;
+
 void configure_attr_defaults( pltb_config_t *config );
 
 /**
@@ -64,12 +135,21 @@ void configure_attr_defaults( pltb_config_t *config );
 pllInstance *init_instance( pllInstanceAttr *attr );
 
 /**
- * Retrieve the MSA (pllAlignmentData) from a file in PHYLIP format. Don't forget to destroy the data after use.
+ * Retrieve the MSA (pllAlignmentData) from a file in PHYLIP format or a binary alignment file
+ * (@see convert_alignment_file). Don't forget to destroy the data after use.
  * @param dataset_file Filename of the file to read & parse
  * @return A pllAlignmentData structure containing the parsed MSA
  */
 pllAlignmentData *read_alignment_data( char *dataset_file );
 
+/**
+ * Stores the MSA of a dataset file as binary alignment file (@see pltb_alignment_file_header_t):
+ * the unique site patterns with their weights, packed as nibbles, along with the content hash.
+ * read_alignment_data maps such files instead of parsing them.
+ * @return 0 on success, 1 otherwise
+ */
+int convert_alignment_file( char *dataset_file, char *binary_file );
+
 /**
  * Create a partition configuration with one single partition containing all sequences. Don't forget to destroy the list after use.
  * @param data The MSA to be partitioned
@@ -85,14 +165,184 @@ partitionList *init_partitions( pllAlignmentData *data, pltb_base_freq_t base_fr
  */
 void prepare_tree_string( pllInstance *inst, partitionList *parts );
 
-void calculate_model_ICs( pltb_model_stat_t *stat, pllAlignmentData*, pllInstance*, unsigned, pltb_config_t* );
+/* hash of the alignment as read from the file (call before committing partitions) */
+uint64_t fingerprint_alignment( pllAlignmentData *data );
+
+/* the stored hash of a binary alignment file, the hash of the alignment otherwise */
+uint64_t fingerprint_dataset( char *dataset_file, pllAlignmentData *data );
+
+/* hash of all settings influencing the evaluation results */
+uint64_t fingerprint_config( pltb_config_t *config );
+
+/**
+ * Calculates the ICs of a model from its likelihood (stat->likelihood).
+ */
+void calculate_model_ICs( pltb_model_stat_t *stat, pllAlignmentData*, unsigned, pltb_config_t* );
+
+/* free parameters of a model besides its substitution rates & branch lengths (alpha, base frequencies) */
+unsigned count_variant_parameters( pltb_config_t *config );
+
+/* the names of the -k & -v options: empirical, equal, optimized resp. gamma, flat-gamma */
+const char *base_freq_name( pltb_base_freq_t base_freq_kind );
+
+const char *rate_het_name( pltb_rate_het_t rate_het );
+
+/**
+ * flat-gamma only approximates uniform rates (@see fix_model_variant), its criteria count no rate
+ * parameter for a model that still has four rate categories: not comparable to the exact variants.
+ */
+bool is_approximate_variant( pltb_config_t *config );
+
+/**
+ * The variants of a dataset & seed compete in a joint selection: their criteria count the free parameters
+ * of each variant, so the values of their selections (@see pltb_config_t) are comparable.
+ * Approximate variants (@see is_approximate_variant) don't take part.
+ * @param variants The evaluated configurations of the variants
+ * @return The exact variant whose selection has the lowest value of the criterion, the first one on ties,
+ * n_variants iff all variants are approximate
+ */
+unsigned select_joint_variant( pltb_config_t *variants, unsigned n_variants, IC criterion );
 
 void merge_into_result( pltb_result_t *local_result, pltb_model_stat_t *stat, unsigned index );
 
+/**
+ * Skips the current model of the model space if it was evaluated by an interrupted run (journal)
+ * or cached by any run: takes over its results, computes the criteria of cached ones, merges
+ * & sinks it and prints its row. Such models provide no warm start state.
+ * @param data The MSA as seen by the instances, for the criteria
+ * @param journal NULL => none
+ * @param cache NULL => none
+ * @param result Receives the model, NULL => merged in model order later
+ * @param out Receives the row unless screening (printed once refined), NULL => printed later
+ * @return true iff the model is done, stat holds its results
+ */
+bool preload_model( pltb_config_t *config, model_space_t *model_space, pllAlignmentData *data,
+		struct pltb_journal *journal, struct pltb_cache *cache, pltb_model_stat_t *stat,
+		pltb_result_t *result, FILE *out );
+
 void tree_search( pllInstance *inst, partitionList *parts );
 
-pllInstance *setup_instance( char *matrix, pllInstanceAttr *attr, pllAlignmentData *alignment_data, partitionList *parts );
+/**
+ * Conducts a complete tree search under the given rate matrix symmetries.
+ * Don't forget to free the string after use.
+ * @param start_tree The starting tree of the model evaluation, reused iff the random seeds of both phases match
+ * @param seed_tree  The ML tree of another model (@see ml_tree) to start from with its branch lengths,
+ *                   NULL or a tree not fitting the alignment => start_tree resp. the parsimony tree
+ * @param ml_tree    NULL or receives the resulting tree incl. taxon names & branch lengths, free after use
+ * @return Newick representation of the resulting tree
+ */
+char *search_tree( char *matrix, pllAlignmentData *data, pltb_config_t *config, char *start_tree,
+		char *seed_tree, char **ml_tree );
+
+/**
+ * Creates an instance ready for optimizing the given rate matrix symmetries.
+ * @param start_tree Newick representation of the starting tree (@see compute_start_tree)
+ *                   or NULL to compute a randomized stepwise addition parsimony tree
+ */
+pllInstance *setup_instance( char *matrix, pllInstanceAttr *attr, pllAlignmentData *alignment_data, partitionList *parts,
+		pltb_base_freq_t base_freq_kind, pltb_rate_het_t rate_het, char *start_tree );
+
+/**
+ * Computes the randomized stepwise addition parsimony tree once. It depends on the random seed only.
+ * Don't forget to free the string after use.
+ * @return Newick representation (with taxa names, without branch lengths) of the tree
+ */
+char *compute_start_tree( pllInstanceAttr *attr, pllAlignmentData *data, pltb_base_freq_t base_freq_kind );
 
-void optimize_model_parameters( pllInstance *inst, partitionList *parts );
+/**
+ * The parsimony starting tree depends on the random seed only: the variants of a seed (base frequencies,
+ * rate heterogeneity) share the tree of the first configuration of [first, c] with that seed.
+ * @return The index of that configuration, c iff the tree is to be computed
+ */
+unsigned start_tree_owner( pltb_config_t *configs, unsigned first, unsigned c );
+
+/**
+ * Computes the starting trees of the configurations of a dataset, once per seed (@see start_tree_owner).
+ * Don't forget to free the strings after use.
+ * @param start_trees Receives the tree of each configuration
+ */
+void compute_start_trees( pltb_config_t *configs, unsigned n_configs, pllAlignmentData *data, char **start_trees );
+
+/* the MSA of a dataset, read once & shared by all its configurations along with their starting trees */
+typedef struct {
+	pllAlignmentData *data;
+	/* @see fingerprint_dataset, taken before the partitions are committed */
+	uint64_t          fingerprint;
+	/* one per configuration of the dataset (@see compute_start_trees) */
+	char            **start_trees;
+	unsigned          n_configs;
+} pltb_dataset_t;
+
+/**
+ * Reads a dataset and computes the starting trees of its configurations.
+ * Don't forget to destroy the dataset after use.
+ * @return 0 on success, 1 iff the dataset can't be read
+ */
+int init_dataset( pltb_dataset_t *dataset, char *dataset_file, pltb_config_t *configs, unsigned n_configs );
+
+void destroy_dataset( pltb_dataset_t *dataset );
+
+/**
+ * Optimizes the model parameters & branch lengths until the likelihood improves by less than epsilon.
+ * @param epsilon The convergence threshold (@see evaluation_epsilon)
+ */
+void optimize_model_parameters( pllInstance *inst, partitionList *parts, double epsilon );
+
+/**
+ * Creates the instance, partitions & starting tree once. Don't forget to destroy the context after use.
+ * @param context The context to initialize
+ * @param attr The attributes of the pllInstance to create
+ * @param data The MSA the instance is built for
+ * @param base_freq_kind The kind of base frequencies used by the partitions
+ * @param rate_het The rate heterogeneity across sites
+ * @param start_tree The shared starting tree or NULL (@see setup_instance)
+ */
+void init_eval_context( pltb_eval_context_t *context, pllInstanceAttr *attr, pllAlignmentData *data,
+		pltb_base_freq_t base_freq_kind, pltb_rate_het_t rate_het, char *start_tree );
+
+/**
+ * Restores the starting state (model parameters & branch lengths) of the context
+ * and applies the given rate matrix symmetries.
+ * @param context The context to reset
+ * @param matrix The rate matrix symmetries to evaluate next
+ */
+void reset_eval_context( pltb_eval_context_t *context, char *matrix );
+
+void destroy_eval_context( pltb_eval_context_t *context );
+
+/* number of branch length values stored by save_branch_lengths */
+unsigned count_branch_lengths( int n_tips );
+
+void save_branch_lengths( pllInstance *inst, double *branch_lengths );
+
+void restore_branch_lengths( pllInstance *inst, double *branch_lengths );
+
+void save_model_params( partitionList *parts, pltb_model_params_t *params );
+
+void restore_model_params( pllInstance *inst, partitionList *parts, pltb_model_params_t *params );
+
+/* number of doubles of a warm start state: model parameters followed by branch lengths */
+unsigned warm_start_length( int n_tips );
+
+/**
+ * Stores the optimized model parameters & branch lengths of the context as warm start state.
+ * @param state Destination of warm_start_length(tips) doubles
+ */
+void save_warm_start( pltb_eval_context_t *context, double *state );
+
+/**
+ * Like reset_eval_context, but starts from a warm start state instead of the starting state.
+ * The rates of the state have to respect the given symmetries, which holds for every parent model.
+ */
+void warm_start_eval_context( pltb_eval_context_t *context, char *matrix, double *state );
+
+/**
+ * Chooses the evaluated parent model (@see parent_models) with the highest likelihood.
+ * @param evaluated Flags for all models of the model space
+ * @param stats The statistics of all models of the model space
+ * @return false iff no parent has been evaluated yet
+ */
+bool select_warm_start_parent( model_space_t *model_space, unsigned index, bool *evaluated,
+		pltb_model_stat_t *stats, unsigned *parent );
 
 #endif
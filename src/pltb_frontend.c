@@ -22,6 +22,7 @@
 #include "ic.h"
 #include "pltb.h"
 #include "models.h"
+#include "sink.h"
 
 #include "pltb_frontend.h"
 
@@ -44,23 +45,23 @@
 		}\
 		fprintf(f, "\n");\
 	} while (0)
-#define PRINT_TREE_SEARCH_HEADER() do {\
-		printf("Tree search for best model(s)\n");\
+#define PRINT_TREE_SEARCH_HEADER(f) do {\
+		fprintf(f, "Tree search for best model(s)\n");\
 	} while (0)
-#define PRINT_TREE_SEARCH_PRETEXT_BEGIN(model) do {\
-		printf("# Model %s [newick] (", model);\
+#define PRINT_TREE_SEARCH_PRETEXT_BEGIN(f, model) do {\
+		fprintf(f, "# Model %s [newick] (", model);\
 	} while (0)
-#define PRINT_TREE_SEARCH_PRETEXT_END() do {\
-		printf(")\n");\
+#define PRINT_TREE_SEARCH_PRETEXT_END(f) do {\
+		fprintf(f, ")\n");\
 	} while (0)
-#define PRINT_TREE_SEARCH_PRETEXT_IC(name) do {\
-		printf("%s", name);\
+#define PRINT_TREE_SEARCH_PRETEXT_IC(f, name) do {\
+		fprintf(f, "%s", name);\
 	} while (0)
-#define PRINT_TREE_SEARCH_PRETEXT_IC_SEP(name) do {\
-		printf(", %s", name);\
+#define PRINT_TREE_SEARCH_PRETEXT_IC_SEP(f, name) do {\
+		fprintf(f, ", %s", name);\
 	} while (0)
-#define PRINT_TREE(repr) do {\
-		printf("%s", repr);\
+#define PRINT_TREE(f, repr) do {\
+		fprintf(f, "%s", repr);\
 	} while (0)
 
 static unsigned insert_unique_model(unsigned *models, unsigned len, unsigned model)
@@ -94,49 +95,164 @@ static void make_indices_absolute( model_space_t *model_space, unsigned (*IC_mod
 	}
 }
 
-void evaluate_result(model_space_t *relative_model_space, pltb_result_t *result, pllAlignmentData *data, pltb_config_t *config)
+unsigned prepare_tree_searches( model_space_t *relative_model_space, pltb_result_t *result, pltb_config_t *config, unsigned *models )
 {
-	pllInstance *tree;
-
 	/* TODO: inplace modifications. ugly! */
 	make_indices_absolute(relative_model_space, &result->matrix_index);
 
+	return prepare_unique_model_tasks(models, &result->matrix_index, config->extra_models, config->n_extra_models);
+}
+
+void open_output( pltb_config_t *config )
+{
+	if (config->output_file == NULL) return;
+
+	config->output = fopen(config->output_file, "a");
+	if (config->output == NULL) {
+		fprintf(stderr, "Can't open %s, writing to the standard output.\n", config->output_file);
+		config->output = stdout;
+	}
+}
+
+void close_output( pltb_config_t *config )
+{
+	if (config->output_file == NULL) return;
+
+	if (config->output != stdout) {
+		fclose(config->output);
+	}
+	config->output = NULL;
+}
+
+void fprint_tree_search_header( FILE *f )
+{
+	PRINT_TREE_SEARCH_HEADER(f);
+}
+
+void fprint_tree_search_pretext( FILE *f, char *matrix_repr_short, pltb_result_t *result, unsigned model )
+{
+	PRINT_TREE_SEARCH_PRETEXT_BEGIN(f, matrix_repr_short);
+	bool first = true;
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		if (result->matrix_index[i] == model) {
+			if (first) {
+				PRINT_TREE_SEARCH_PRETEXT_IC(f, get_IC_name_short(i));
+				first = false;
+			} else {
+				PRINT_TREE_SEARCH_PRETEXT_IC_SEP(f, get_IC_name_short(i));
+			}
+		}
+	}
+	if (first) {
+		PRINT_TREE_SEARCH_PRETEXT_IC(f, "extra");
+	}
+	PRINT_TREE_SEARCH_PRETEXT_END(f);
+}
+
+void fprint_tree( FILE *f, char *newick )
+{
+	PRINT_TREE(f, newick);
+}
+
+void evaluate_result(model_space_t *relative_model_space, pltb_result_t *result, pllAlignmentData *data, pltb_config_t *config, char *start_tree)
+{
 	unsigned *models  = malloc(sizeof(unsigned) * (IC_MAX + config->n_extra_models));
-	unsigned n_models = prepare_unique_model_tasks(models, &result->matrix_index, config->extra_models, config->n_extra_models);
+	unsigned n_models = prepare_tree_searches(relative_model_space, result, config, models);
 
 	model_space_t model_space;
 	init_selection_model_space(&model_space, models, n_models);
+	TIME_STRUCT_INIT(phase);
+	pltb_counter_sample_t counters;
+	/* the ML tree of the first search, the start of the others */
+	char *seed_tree = NULL;
 
-	PRINT_TREE_SEARCH_HEADER();
+	fprint_tree_search_header(config->output);
 	while (next_model(&model_space)) {
-		PRINT_TREE_SEARCH_PRETEXT_BEGIN(model_space.matrix_repr_short);
-		bool first = true;
-		for (unsigned i = 0; i < IC_MAX; i++) {
-			if (result->matrix_index[i] == models[model_space.matrix_index]) {
-				if (first) {
-					PRINT_TREE_SEARCH_PRETEXT_IC(get_IC_name_short(i));
-					first = false;
-				} else {
-					PRINT_TREE_SEARCH_PRETEXT_IC_SEP(get_IC_name_short(i));
-				}
-			}
-		}
-		if (first) {
-			PRINT_TREE_SEARCH_PRETEXT_IC("extra");
-		}
-		PRINT_TREE_SEARCH_PRETEXT_END();
+		fprint_tree_search_pretext(config->output, model_space.matrix_repr_short, result, models[model_space.matrix_index]);
 
-		partitionList *parts = init_partitions(data, config->base_freq_kind);
 		/* do the actual work */
-		tree = setup_instance(model_space.matrix_repr, &config->attr_tree_search, data, parts);
-		tree_search(tree, parts);
-		prepare_tree_string(tree, parts);
-		PRINT_TREE(tree->tree_string);
-		pllPartitionsDestroy(tree, &parts);
-		pllDestroyInstance(tree);
+		sample_counters(&counters);
+		PHASE_START(phase);
+		char *newick = search_tree(model_space.matrix_repr, data, config, start_tree, seed_tree,
+				config->seed_tree_searches && seed_tree == NULL ? &seed_tree : NULL);
+		PHASE_END(config->profile, PHASE_TREE_SEARCH, phase);
+		add_tree_counters(config->profile, &counters);
+		fprint_tree(config->output, newick);
+		if (config->sink != NULL) {
+			sink_tree(config->sink, config, model_space.matrix_repr_short, result, models[model_space.matrix_index], newick);
+		}
+		free(newick);
 	}
 
+	free(seed_tree);
 	destroy_model_space(&model_space);
+	free(models);
+}
+
+/* the selection of the run under the same criterion, "-" for new criteria */
+static char *stored_selection(pltb_stored_result_t *result, const pltb_criterion_t *criterion)
+{
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		if (strcmp(get_IC_name_short(i), criterion->name) == 0 && result->selection[i][0] != '\0') {
+			return result->selection[i];
+		}
+	}
+	return "-";
+}
+
+void fprint_reselection( FILE *f, char *path, pltb_stored_result_t *result, const pltb_criterion_t **criteria,
+		unsigned n_criteria, double *values, double *weights, bool all_models )
+{
+	unsigned n = result->n_models;
+	fprintf(f, "Reselection of %s: %u models, %u sites, %u taxa\n", path, n, result->sites, result->taxa);
+	PRINT_HLINE(f);
+	fprintf(f, " Criterion | Model  |   Value    |  Weight  |  Run   | Tree\n");
+	PRINT_HLINE(f);
+	for (unsigned c = 0; c < n_criteria; c++) {
+		unsigned best = select_stored_model(&values[c * n], n);
+		char *run = stored_selection(result, criteria[c]);
+		fprintf(f, " %-9s | %s | %10.8g | %8.6f | %6s | %s\n", criteria[c]->name, result->models[best],
+				values[c * n + best], weights[c * n + best], run,
+				has_stored_tree(result, result->models[best]) ? "stored" : "missing");
+	}
+	PRINT_HLINE(f);
+	if (!all_models) {
+		return;
+	}
+	fprintf(f, " Symm.  | K |  k  | Likelihood ");
+	for (unsigned c = 0; c < n_criteria; c++) {
+		fprintf(f, "| %-9s  Weight   ", criteria[c]->name);
+	}
+	fprintf(f, "\n");
+	for (unsigned i = 0; i < n; i++) {
+		fprintf(f, " %s | %u | %3.0f | %10.8g ", result->models[i], result->K[i], result->params[i], result->likelihoods[i]);
+		for (unsigned c = 0; c < n_criteria; c++) {
+			fprintf(f, "| %9.8g %8.6f ", values[c * n + i], weights[c * n + i]);
+		}
+		fprintf(f, "\n");
+	}
+	PRINT_HLINE(f);
+}
+
+void fprint_reselected_tree( FILE *f, char *matrix_repr_short, pltb_stored_result_t *result,
+		const pltb_criterion_t **criteria, unsigned n_criteria, double *values, char *newick )
+{
+	unsigned n = result->n_models;
+	PRINT_TREE_SEARCH_PRETEXT_BEGIN(f, matrix_repr_short);
+	bool first = true;
+	for (unsigned c = 0; c < n_criteria; c++) {
+		if (strcmp(result->models[select_stored_model(&values[c * n], n)], matrix_repr_short) != 0) {
+			continue;
+		}
+		if (first) {
+			PRINT_TREE_SEARCH_PRETEXT_IC(f, criteria[c]->name);
+			first = false;
+		} else {
+			PRINT_TREE_SEARCH_PRETEXT_IC_SEP(f, criteria[c]->name);
+		}
+	}
+	PRINT_TREE_SEARCH_PRETEXT_END(f);
+	PRINT_TREE(f, newick);
 }
 
 char *get_IC_name_short(IC criterion)
@@ -182,8 +298,19 @@ void fprint_progress_end(FILE *f)
 	fprintf(f, "/\n");
 }
 
-void fprint_eval_header(FILE *f)
+void fprint_makespan(FILE *f, double predicted, double actual)
 {
+	fprintf(f, "Makespan of model evaluation: %.3f s (predicted: %.3f s)\n", actual, predicted);
+}
+
+void fprint_eval_header(FILE *f, pltb_config_t *config)
+{
+	/* the default variant (empirical base frequencies, +G) goes without saying */
+	if (config->base_freq_kind != EMPIRICAL || config->rate_het != RATE_GAMMA) {
+		fprintf(f, "Variant: %s base frequencies, %s\n", base_freq_name(config->base_freq_kind),
+		        config->rate_het == RATE_FLAT_GAMMA ? "flat gamma (alpha fixed at its maximum, approximately uniform rates)"
+		                                            : "gamma");
+	}
 	PRINT_HLINE(f);
 	PRINT_HEADER(f);
 	PRINT_HLINE(f);
@@ -214,3 +341,237 @@ void fprint_eval_summary(FILE *f, model_space_t *model_space, pltb_model_stat_t
 	PRINT_SUMMARY(f, overall_time_cpu, overall_time_real, chosen_models);
 	PRINT_HLINE(f);
 }
+
+void fprint_climb_summary(FILE *f, unsigned n_evaluated, unsigned n_models)
+{
+	fprintf(f, "Greedy climb: %u of %u models evaluated\n", n_evaluated, n_models);
+}
+
+void report_eval_results(FILE *f, pltb_config_t *config, model_space_t *model_space, pltb_model_stat_t *stats,
+		bool rows, pltb_result_t *result, pltb_climb_t *climb, unsigned *contenders, unsigned n_contenders)
+{
+	for (unsigned i = 0; rows && i < model_space->matrix_count; i++) {
+		/* the models left out by a greedy climb don't add to the summary */
+		if (climb != NULL && !climb->evaluated[i]) continue;
+		fprint_eval_row(f, model_space, &stats[i]);
+	}
+	fprint_eval_summary(f, model_space, (pltb_model_stat_t (*)[])stats, result);
+	config->selection = *result;
+	if (config->sink != NULL) {
+		sink_selection(config->sink, config, model_space, result);
+	}
+	if (climb != NULL) {
+		fprint_climb_summary(f, climb->n_evaluated, model_space->matrix_count);
+	}
+	if (config->screen_epsilon > 0) {
+		fprint_screening_summary(f, model_space, stats, contenders, n_contenders, config);
+	}
+}
+
+void fprint_joint_selection(FILE *f, model_space_t *model_space, pltb_config_t *variants, unsigned n_variants)
+{
+	fprintf(f, "Joint selection over the variants of %s, seed 0x%05lX\n", variants[0].dataset_file,
+			(unsigned long)variants[0].attr_model_eval.randomNumberSeed);
+	PRINT_HLINE(f);
+	fprintf(f, " Criterion | Base freqs | Rate het.   | Model  |   Value    |  Delta\n");
+	PRINT_HLINE(f);
+	bool approximate = false;
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		/* stable insertion sort by the value of the variant's selection, the approximate variants go last unranked */
+		unsigned ranking[n_variants];
+		unsigned n_ranked = 0;
+		for (unsigned v = 0; v < n_variants; v++) {
+			if (is_approximate_variant(&variants[v])) continue;
+			unsigned k = n_ranked++;
+			for (; k > 0 && variants[ranking[k - 1]].selection.ic[i] > variants[v].selection.ic[i]; k--) {
+				ranking[k] = ranking[k - 1];
+			}
+			ranking[k] = v;
+		}
+		for (unsigned v = 0, k = n_ranked; v < n_variants; v++) {
+			if (is_approximate_variant(&variants[v])) ranking[k++] = v;
+		}
+		for (unsigned r = 0; r < n_variants; r++) {
+			pltb_config_t *variant = &variants[ranking[r]];
+			set_model(model_space, variant->selection.matrix_index[i]);
+			if (r >= n_ranked) {
+				approximate = true;
+				fprintf(f, " %-9s | %-10s | %-10s* | %s | %10.8g |        -\n", r == 0 ? get_IC_name_short(i) : "",
+						base_freq_name(variant->base_freq_kind), rate_het_name(variant->rate_het),
+						model_space->matrix_repr_short, variant->selection.ic[i]);
+				continue;
+			}
+			fprintf(f, " %-9s | %-10s | %-11s | %s | %10.8g | %8.3f%s\n", r == 0 ? get_IC_name_short(i) : "",
+					base_freq_name(variant->base_freq_kind), rate_het_name(variant->rate_het),
+					model_space->matrix_repr_short, variant->selection.ic[i],
+					variant->selection.ic[i] - variants[ranking[0]].selection.ic[i], r == 0 ? " <-" : "");
+		}
+	}
+	PRINT_HLINE(f);
+	if (approximate) {
+		fprintf(f, "* approximation of uniform rates (alpha fixed at its maximum), not ranked\n");
+	}
+}
+
+void fprint_profile(FILE *f, pltb_profile_t *profiles, unsigned n_processes, double run_real)
+{
+	pltb_profile_t total;
+	double         slowest[PHASE_MAX];
+	double         sum = 0;
+	init_profile(&total);
+	memset(slowest, 0, sizeof(slowest));
+	for (unsigned p = 0; p < n_processes; p++) {
+		merge_profile(&total, &profiles[p]);
+		for (unsigned i = 0; i < PHASE_MAX; i++) {
+			if (profiles[p].real[i] > slowest[i]) slowest[i] = profiles[p].real[i];
+		}
+	}
+	for (unsigned i = 0; i < PHASE_MAX; i++) {
+		sum += total.real[i];
+	}
+
+	fprintf(f, "Phase breakdown: %.3f s real time, %u process(es)\n", run_real, n_processes);
+	PRINT_HLINE(f);
+	fprintf(f, "    Phase     |  Count  |   CPU    |  REAL    |  Mean    | Max/Proc | Share\n");
+	PRINT_HLINE(f);
+	for (unsigned i = 0; i < PHASE_MAX; i++) {
+		if (total.count[i] == 0) continue;
+		fprintf(f, " %-12s | %7lu | %8.3f | %8.3f | %8.4f | %8.3f | %5.1f%%\n", get_phase_name(i),
+				(unsigned long)total.count[i], total.cpu[i], total.real[i], total.real[i] / (double)total.count[i],
+				slowest[i], sum > 0 ? 100 * total.real[i] / sum : 0);
+	}
+	PRINT_HLINE(f);
+	if (n_processes < 2) return;
+
+	/* real time per process */
+	fprintf(f, " Proc ");
+	for (unsigned i = 0; i < PHASE_MAX; i++) {
+		fprintf(f, "|%11s", get_phase_name(i));
+	}
+	fprintf(f, "\n");
+	for (unsigned p = 0; p < n_processes; p++) {
+		fprintf(f, " %4u ", p);
+		for (unsigned i = 0; i < PHASE_MAX; i++) {
+			fprintf(f, "|%11.3f", profiles[p].real[i]);
+		}
+		fprintf(f, "\n");
+	}
+	PRINT_HLINE(f);
+}
+
+/* a ratio of two counters or n/a iff one of them isn't available */
+static void fprint_counter_ratio(FILE *f, uint64_t *counters, uint32_t available,
+		pltb_counter_t numerator, pltb_counter_t denominator, double scale)
+{
+	if (!(available & (1u << numerator)) || !(available & (1u << denominator)) || counters[denominator] == 0) {
+		fprintf(f, "|      n/a ");
+	} else {
+		fprintf(f, "| %8.3f ", scale * (double)counters[numerator] / (double)counters[denominator]);
+	}
+}
+
+static void fprint_counter_row(FILE *f, const char *label, uint64_t *counters, uint32_t available)
+{
+	fprintf(f, " %-13s", label);
+	if (available & (1u << COUNTER_INSTRUCTIONS)) {
+		fprintf(f, "| %8.3f ", (double)counters[COUNTER_INSTRUCTIONS] / 1e9);
+	} else {
+		fprintf(f, "|      n/a ");
+	}
+	fprint_counter_ratio(f, counters, available, COUNTER_INSTRUCTIONS, COUNTER_CYCLES, 1);
+	fprint_counter_ratio(f, counters, available, COUNTER_LLC_MISSES, COUNTER_LLC_REFERENCES, 100);
+	fprint_counter_ratio(f, counters, available, COUNTER_LLC_MISSES, COUNTER_INSTRUCTIONS, 1000);
+	fprint_counter_ratio(f, counters, available, COUNTER_FP_SCALAR, COUNTER_INSTRUCTIONS, 100);
+	fprint_counter_ratio(f, counters, available, COUNTER_FP_VECTOR, COUNTER_INSTRUCTIONS, 100);
+	fprintf(f, "\n");
+}
+
+void fprint_counters(FILE *f, pltb_profile_t *profiles, unsigned n_processes)
+{
+	pltb_profile_t total;
+	init_profile(&total);
+	for (unsigned p = 0; p < n_processes; p++) {
+		merge_profile(&total, &profiles[p]);
+	}
+	uint32_t available = total.counters_available;
+
+	/* per K & over all models */
+	uint64_t per_K[MAX_FREE_PARAMETER_COUNT + 1][COUNTER_MAX];
+	uint64_t models[COUNTER_MAX];
+	memset(per_K, 0, sizeof(per_K));
+	memset(models, 0, sizeof(models));
+	model_space_t model_space;
+	init_default_model_space(&model_space);
+	for (unsigned m = 0; m < MAX_MATRIX_INDEX; m++) {
+		set_model(&model_space, m);
+		for (unsigned i = 0; i < COUNTER_MAX; i++) {
+			per_K[model_space.K][i] += total.model_counters[model_space.matrix_index][i];
+			models[i]               += total.model_counters[model_space.matrix_index][i];
+		}
+	}
+
+	fprintf(f, "Hardware counters of the evaluating threads (user space, PLL threads not covered)\n");
+	PRINT_HLINE(f);
+	fprintf(f, "              | Instr[G] |   IPC    | LLC miss%%| LLC MPKI | FP scal%% | FP vec%%\n");
+	PRINT_HLINE(f);
+	for (unsigned K = 1; K <= MAX_FREE_PARAMETER_COUNT; K++) {
+		if (per_K[K][COUNTER_CYCLES] == 0 && per_K[K][COUNTER_INSTRUCTIONS] == 0) continue;
+		char label[16];
+		snprintf(label, sizeof(label), "K = %u", K);
+		fprint_counter_row(f, label, per_K[K], available);
+	}
+	fprint_counter_row(f, "all models", models, available);
+	fprint_counter_row(f, "tree search", total.tree_counters, available);
+	PRINT_HLINE(f);
+
+	/* per model */
+	for (unsigned m = 0; m < MAX_MATRIX_INDEX; m++) {
+		set_model(&model_space, m);
+		uint64_t *counters = total.model_counters[model_space.matrix_index];
+		if (counters[COUNTER_CYCLES] == 0 && counters[COUNTER_INSTRUCTIONS] == 0) continue;
+		char label[16];
+		snprintf(label, sizeof(label), "%s | %u", model_space.matrix_repr_short, model_space.K);
+		fprint_counter_row(f, label, counters, available);
+	}
+	PRINT_HLINE(f);
+	destroy_model_space(&model_space);
+	if (n_processes < 2) return;
+
+	for (unsigned p = 0; p < n_processes; p++) {
+		uint64_t process[COUNTER_MAX];
+		memcpy(process, profiles[p].tree_counters, sizeof(process));
+		for (unsigned m = 0; m < MAX_MATRIX_INDEX; m++) {
+			for (unsigned i = 0; i < COUNTER_MAX; i++) {
+				process[i] += profiles[p].model_counters[m][i];
+			}
+		}
+		char label[24];
+		snprintf(label, sizeof(label), "process %u", p);
+		fprint_counter_row(f, label, process, profiles[p].counters_available);
+	}
+	PRINT_HLINE(f);
+}
+
+void fprint_screening_summary(FILE *f, model_space_t *model_space, pltb_model_stat_t *stats,
+		unsigned *contenders, unsigned n_contenders, pltb_config_t *config)
+{
+	fprintf(f, "Screening (epsilon %g): %u of %u models re-optimized within %g IC units of the leaders\n",
+			config->screen_epsilon, n_contenders, model_space->matrix_count, config->screen_margin);
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		/* stable insertion sort by the final criterion */
+		unsigned ranking[n_contenders > 0 ? n_contenders : 1];
+		for (unsigned j = 0; j < n_contenders; j++) {
+			unsigned k = j;
+			for (; k > 0 && stats[ranking[k - 1]].ic[i] > stats[contenders[j]].ic[i]; k--) {
+				ranking[k] = ranking[k - 1];
+			}
+			ranking[k] = contenders[j];
+		}
+		fprintf(f, " %-6s |", get_IC_name_short(i));
+		for (unsigned j = 0; j < n_contenders; j++) {
+			set_model(model_space, ranking[j]);
+			fprintf(f, " %s", model_space->matrix_repr_short);
+		}
+		fprintf(f, "\n");
+	}
+}
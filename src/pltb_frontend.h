@@ -19,8 +19,10 @@
 #define PLTB_FRONTEND_H
 
 #include <pll/pll.h>
+#include "climb.h"
 #include "pltb.h"
 #include "models.h"
+#include "reselect.h"
 
 #define OUTPUT_WIDTH 107
 
@@ -30,13 +32,105 @@ unsigned fprint_progress_step(FILE *f, unsigned last, unsigned curr, unsigned ma
 
 void fprint_progress_end(FILE *f);
 
-void fprint_eval_header(FILE *f);
+/**
+ * Reports the makespan of the model evaluation predicted by the cost model versus the measured one.
+ */
+void fprint_makespan(FILE *f, double predicted, double actual);
+
+/* preceded by the variant of the configuration unless it is the default one */
+void fprint_eval_header(FILE *f, pltb_config_t *config);
 
 void fprint_eval_row(FILE *f, model_space_t *model_space, pltb_model_stat_t *stat);
 
 void fprint_eval_summary(FILE *f, model_space_t *model_space, pltb_model_stat_t (*stats)[], pltb_result_t *result);
 
-void evaluate_result( model_space_t *model_space, pltb_result_t *result, pllAlignmentData *data, pltb_config_t *config);
+/**
+ * Reports how many models of the model space a greedy climb evaluated.
+ */
+void fprint_climb_summary(FILE *f, unsigned n_evaluated, unsigned n_models);
+
+/**
+ * Reports the models re-optimized after screening, ranked by every information criterion.
+ * @param stats Per (relative) model, final
+ * @param contenders The re-optimized (relative) models (@see select_contenders)
+ */
+void fprint_screening_summary(FILE *f, model_space_t *model_space, pltb_model_stat_t *stats,
+		unsigned *contenders, unsigned n_contenders, pltb_config_t *config);
+
+/**
+ * Reports the evaluation of a configuration once all its models are done: the rows of the evaluated
+ * models in model order, the selection per criterion (kept as the configuration's selection & sunk)
+ * and the summaries of a greedy climb and a screening.
+ * @param rows Print the rows, false => printed as the models came in
+ * @param stats Per (relative) model, final
+ * @param climb NULL => the whole model space was evaluated
+ * @param contenders The re-optimized (relative) models of a screening (@see select_contenders)
+ */
+void report_eval_results(FILE *f, pltb_config_t *config, model_space_t *model_space, pltb_model_stat_t *stats,
+		bool rows, pltb_result_t *result, pltb_climb_t *climb, unsigned *contenders, unsigned n_contenders);
+
+/**
+ * Reports the joint selection over the variants of a dataset & seed (@see select_joint_variant):
+ * per criterion the selections of the exact variants, ranked by their value, the joint selection first,
+ * followed by the ones of the approximate variants (@see is_approximate_variant), marked & not ranked.
+ * @param variants The evaluated configurations of the variants
+ */
+void fprint_joint_selection(FILE *f, model_space_t *model_space, pltb_config_t *variants, unsigned n_variants);
+
+/**
+ * Reports where the time of a run went: the phases of all processes summed up, the mean per occurrence
+ * (per model for reset & optimize) and the slowest process, followed by the phases per process.
+ * @param profiles One per process, the master's first
+ * @param run_real The real time of the whole run
+ */
+void fprint_profile(FILE *f, pltb_profile_t *profiles, unsigned n_processes, double run_real);
+
+/**
+ * Reports the hardware counters (@see counters.h) of the optimizations per K & model and of the
+ * tree searches: instructions per cycle, LLC misses per reference & per 1000 instructions and the
+ * shares of scalar & vector floating point instructions, followed by the same per process.
+ * @param profiles One per process, the master's first
+ */
+void fprint_counters(FILE *f, pltb_profile_t *profiles, unsigned n_processes);
+
+/**
+ * Makes the selected model indices absolute and collects the unique models to conduct a tree search for.
+ * @param models Buffer of at least IC_MAX + config->n_extra_models entries
+ * @return The number of unique models
+ */
+unsigned prepare_tree_searches( model_space_t *model_space, pltb_result_t *result, pltb_config_t *config, unsigned *models );
+
+/**
+ * Opens the output file of a configuration (if any) for appending.
+ * Falls back to the standard output iff the file can't be opened.
+ */
+void open_output( pltb_config_t *config );
+
+/* closes the output file of a configuration (if any) */
+void close_output( pltb_config_t *config );
+
+void fprint_tree_search_header( FILE *f );
+
+void fprint_tree_search_pretext( FILE *f, char *matrix_repr_short, pltb_result_t *result, unsigned model );
+
+void fprint_tree( FILE *f, char *newick );
+
+/**
+ * Conducts the tree searches for the selected models, printed to the output of the configuration.
+ * @param start_tree The starting tree of the model evaluation, reused iff the random seeds of both phases match
+ */
+void evaluate_result( model_space_t *model_space, pltb_result_t *result, pllAlignmentData *data, pltb_config_t *config, char *start_tree );
+
+/**
+ * Prints the selection of every criterion recomputed from a result file (@see reselect.h)
+ * next to the selection of the run, and with all_models each model's values & weights.
+ */
+void fprint_reselection( FILE *f, char *path, pltb_stored_result_t *result, const pltb_criterion_t **criteria,
+		unsigned n_criteria, double *values, double *weights, bool all_models );
+
+/* the tree of a reselected model, in the format of the tree searches of a run */
+void fprint_reselected_tree( FILE *f, char *matrix_repr_short, pltb_stored_result_t *result,
+		const pltb_criterion_t **criteria, unsigned n_criteria, double *values, char *newick );
 
 char *get_IC_name_short(IC criterion);
 
@@ -0,0 +1,79 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+
+#include "profile.h"
+
+void init_profile( pltb_profile_t *profile )
+{
+	memset(profile, 0, sizeof(*profile));
+}
+
+void add_phase( pltb_profile_t *profile, pltb_phase_t phase, double cpu, double real )
+{
+	if (profile == NULL) {
+		return;
+	}
+	profile->cpu[phase]  += cpu;
+	profile->real[phase] += real;
+	profile->count[phase]++;
+}
+
+void add_model_counters( pltb_profile_t *profile, unsigned model, pltb_counter_sample_t *since )
+{
+	if (profile == NULL) {
+		return;
+	}
+	add_counters_since(since, profile->model_counters[model], &profile->counters_available);
+}
+
+void add_tree_counters( pltb_profile_t *profile, pltb_counter_sample_t *since )
+{
+	if (profile == NULL) {
+		return;
+	}
+	add_counters_since(since, profile->tree_counters, &profile->counters_available);
+}
+
+void merge_profile( pltb_profile_t *into, pltb_profile_t *from )
+{
+	if (into == NULL) {
+		return;
+	}
+	for (unsigned i = 0; i < PHASE_MAX; i++) {
+		into->cpu[i]   += from->cpu[i];
+		into->real[i]  += from->real[i];
+		into->count[i] += from->count[i];
+	}
+	for (unsigned m = 0; m < MAX_MATRIX_INDEX; m++) {
+		for (unsigned i = 0; i < COUNTER_MAX; i++) {
+			into->model_counters[m][i] += from->model_counters[m][i];
+		}
+	}
+	for (unsigned i = 0; i < COUNTER_MAX; i++) {
+		into->tree_counters[i] += from->tree_counters[i];
+	}
+	into->counters_available |= from->counters_available;
+}
+
+const char *get_phase_name( pltb_phase_t phase )
+{
+	static const char *names[PHASE_MAX] = { "read", "start tree", "setup", "reset", "optimize",
+	                                        "wait", "reduce", "tree search" };
+	return names[phase];
+}
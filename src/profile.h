@@ -0,0 +1,92 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "counters.h"
+#include "models.h"
+
+#ifdef __APPLE__
+#include "time_mach.h"
+#else
+#include "time.h"
+#endif
+
+/* the phases of a run, each process (or evaluation thread) accumulates its own durations */
+typedef enum {
+	/* reading & parsing (or receiving) an alignment */
+	PHASE_READ,
+	/* parsimony starting trees */
+	PHASE_START_TREE,
+	/* evaluation contexts: partitions, instance, alignment load & model initialization */
+	PHASE_SETUP,
+	/* per model: restoring the starting or a warm start state */
+	PHASE_RESET,
+	/* per model: model parameter optimization, the CPU & REAL columns of the evaluation table */
+	PHASE_OPTIMIZE,
+	/* MPI: waiting for a task (worker) or for results (master) */
+	PHASE_WAIT,
+	/* MPI: reduction of the results */
+	PHASE_REDUCE,
+	/* ML tree searches of the selected (and extra) models */
+	PHASE_TREE_SEARCH,
+	PHASE_MAX
+} pltb_phase_t;
+
+/**
+ * Accumulated durations per phase. Not thread-safe, every thread measures into a profile
+ * of its own and the profiles are merged once the threads are done.
+ */
+typedef struct {
+	double   cpu[PHASE_MAX];
+	double   real[PHASE_MAX];
+	uint64_t count[PHASE_MAX];
+	/* hardware counters (@see counters.h) of the optimizations per (absolute) model & of the tree searches */
+	uint64_t model_counters[MAX_MATRIX_INDEX][COUNTER_MAX];
+	uint64_t tree_counters[COUNTER_MAX];
+	/* a bit per counter counted at least once */
+	uint32_t counters_available;
+} pltb_profile_t;
+
+/* measures a phase with a timer of time.h into a profile, NULL => not profiled */
+#define PHASE_START(var) do { TIME_START(var); } while (0)
+#define PHASE_END(profile, phase, var) do { TIME_END(var); \
+	add_phase(profile, phase, TIME_CPU(var), TIME_REAL(var)); } while (0)
+
+void init_profile( pltb_profile_t *profile );
+
+/* adds one occurrence of a phase, no-op on a NULL profile */
+void add_phase( pltb_profile_t *profile, pltb_phase_t phase, double cpu, double real );
+
+/**
+ * Adds the hardware counts of the calling thread since the sample to the optimizations of a model,
+ * no-op on a NULL profile or without counters.
+ * @param model The absolute model index
+ */
+void add_model_counters( pltb_profile_t *profile, unsigned model, pltb_counter_sample_t *since );
+
+/* adds the hardware counts of the calling thread since the sample to the tree searches */
+void add_tree_counters( pltb_profile_t *profile, pltb_counter_sample_t *since );
+
+/* adds all phases of another profile, no-op on a NULL profile */
+void merge_profile( pltb_profile_t *into, pltb_profile_t *from );
+
+const char *get_phase_name( pltb_phase_t phase );
+
+#endif
@@ -0,0 +1,224 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "reselect.h"
+
+static const pltb_criterion_t criteria[N_CRITERIA] = {
+	{ "AIC",    PENALTY_AIC,  false },
+	{ "AICc-S", PENALTY_AICc, false },
+	{ "AICc-M", PENALTY_AICc, true  },
+	{ "BIC-S",  PENALTY_BIC,  false },
+	{ "BIC-M",  PENALTY_BIC,  true  },
+	{ "HQC-S",  PENALTY_HQC,  false },
+	{ "HQC-M",  PENALTY_HQC,  true  }
+};
+
+const pltb_criterion_t *find_criterion( char *name )
+{
+	for (unsigned i = 0; i < N_CRITERIA; i++) {
+		if (strcasecmp(criteria[i].name, name) == 0) {
+			return &criteria[i];
+		}
+	}
+	return NULL;
+}
+
+const pltb_criterion_t *get_criterion( unsigned index )
+{
+	return index < N_CRITERIA ? &criteria[index] : NULL;
+}
+
+static void add_model( pltb_stored_result_t *result, char *model, unsigned K, double likelihood, double *stored )
+{
+	unsigned n = result->n_models + 1;
+	result->models      = realloc(result->models, sizeof(*result->models) * n);
+	result->K           = realloc(result->K, sizeof(unsigned) * n);
+	result->likelihoods = realloc(result->likelihoods, sizeof(double) * n);
+	result->params      = realloc(result->params, sizeof(double) * n);
+	result->stored      = realloc(result->stored, sizeof(*result->stored) * n);
+
+	strncpy(result->models[result->n_models], model, MODEL_MATRIX_REPRESENTATION_LENGTH_SHORT);
+	result->K[result->n_models]           = K;
+	result->likelihoods[result->n_models] = likelihood;
+	/* AIC = -2 lnL + 2k, both printed to two decimals at least */
+	result->params[result->n_models]      = round((stored[AIC] + 2 * likelihood) / 2);
+	memcpy(result->stored[result->n_models], stored, sizeof(double) * IC_MAX);
+	result->n_models = n;
+}
+
+/* the overview line: | -> <model> once per stored criterion */
+static void read_selection( pltb_stored_result_t *result, char *line )
+{
+	char *arrow = line;
+	for (unsigned i = 0; i < IC_MAX && (arrow = strstr(arrow, "->")) != NULL; i++) {
+		arrow += 2;
+		sscanf(arrow, "%6s", result->selection[i]);
+	}
+}
+
+bool read_stored_result( char *path, pltb_stored_result_t *result )
+{
+	memset(result, 0, sizeof(pltb_stored_result_t));
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		return false;
+	}
+	char   *line     = NULL;
+	size_t  capacity = 0;
+	bool    table    = true;
+	while (getline(&line, &capacity, f) != -1) {
+		char     model[MODEL_MATRIX_REPRESENTATION_LENGTH_SHORT];
+		unsigned K;
+		double   cpu, real, likelihood, stored[IC_MAX];
+		if (table && sscanf(line, " %6s | %u | %lf | %lf | %lf | %lf | %lf | %lf | %lf | %lf", model, &K,
+				&cpu, &real, &likelihood, &stored[AIC], &stored[AICc_C], &stored[AICc_RC],
+				&stored[BIC_C], &stored[BIC_RC]) == 10) {
+			add_model(result, model, K, likelihood, stored);
+		} else if (table && strncmp(line, " Overview", 9) == 0) {
+			/* later tables (e.g. of a screening) aren't evaluation results */
+			read_selection(result, line);
+			table = false;
+		} else if (sscanf(line, "# Model %6s", model) == 1) {
+			result->trees = realloc(result->trees, sizeof(*result->trees) * (result->n_trees + 1));
+			strncpy(result->trees[result->n_trees++], model, MODEL_MATRIX_REPRESENTATION_LENGTH_SHORT);
+		}
+	}
+	free(line);
+	fclose(f);
+
+	if (result->n_models == 0) {
+		destroy_stored_result(result);
+		return false;
+	}
+	derive_sample_sizes(result);
+	return true;
+}
+
+void destroy_stored_result( pltb_stored_result_t *result )
+{
+	free(result->models);
+	free(result->K);
+	free(result->likelihoods);
+	free(result->params);
+	free(result->stored);
+	free(result->trees);
+	memset(result, 0, sizeof(pltb_stored_result_t));
+}
+
+void derive_sample_sizes( pltb_stored_result_t *result )
+{
+	/* BIC = -2 lnL + k ln n => ln n = (BIC + 2 lnL) / k */
+	double log_sites = 0, log_cells = 0;
+	unsigned n = 0;
+	for (unsigned i = 0; i < result->n_models; i++) {
+		if (result->params[i] > 0) {
+			log_sites += (result->stored[i][BIC_C] + 2 * result->likelihoods[i]) / result->params[i];
+			log_cells += (result->stored[i][BIC_RC] + 2 * result->likelihoods[i]) / result->params[i];
+			n++;
+		}
+	}
+	if (n == 0) {
+		result->sites = result->taxa = 0;
+		return;
+	}
+	double sites = round(exp(log_sites / n));
+	double taxa  = round(exp(log_cells / n) / sites);
+	result->sites = (unsigned)sites;
+	result->taxa  = sites > 0 ? (unsigned)taxa : 0;
+}
+
+void compute_criteria( pltb_stored_result_t *result, const pltb_criterion_t **selected, unsigned n_criteria,
+		double *values, double *weights )
+{
+	unsigned n = result->n_models;
+	for (unsigned c = 0; c < n_criteria; c++) {
+		double *v = &values[c * n];
+		double *w = &weights[c * n];
+		double size = selected[c]->per_cell ? (double)result->sites * result->taxa : (double)result->sites;
+		calculate_IC_batch(selected[c]->penalty, size, result->likelihoods, result->params, n, v);
+
+		double best = v[select_stored_model(v, n)];
+		double sum  = 0;
+		for (unsigned i = 0; i < n; i++) {
+			w[i] = exp(-(v[i] - best) / 2);
+			sum += w[i];
+		}
+		for (unsigned i = 0; i < n; i++) {
+			w[i] /= sum;
+		}
+	}
+}
+
+unsigned select_stored_model( double *values, unsigned n_models )
+{
+	unsigned best = 0;
+	for (unsigned i = 1; i < n_models; i++) {
+		if (values[i] < values[best]) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+bool has_stored_tree( pltb_stored_result_t *result, char *matrix_repr_short )
+{
+	for (unsigned i = 0; i < result->n_trees; i++) {
+		if (strcmp(result->trees[i], matrix_repr_short) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void configure_from_file_name( pltb_config_t *config, char *path )
+{
+	char *name = strrchr(path, '/');
+	name = name != NULL ? name + 1 : path;
+
+	/* the suffixes follow the seed, the prefix may contain anything */
+	char *suffix = strstr(name, "-0x");
+	if (suffix != NULL) {
+		config->attr_model_eval.randomNumberSeed  = strtol(suffix + 1, &suffix, 16);
+		config->attr_tree_search.randomNumberSeed = config->attr_model_eval.randomNumberSeed;
+	} else {
+		suffix = name;
+	}
+	config->base_freq_kind = strstr(suffix, "-opt") != NULL ? OPTIMIZED : strstr(suffix, "-eq") != NULL ? EQUAL : EMPIRICAL;
+	config->rate_het       = strstr(suffix, "-flat-gamma") != NULL ? RATE_FLAT_GAMMA : RATE_GAMMA;
+}
+
+bool find_matrix_repr( char *matrix_repr_short, char *matrix_repr )
+{
+	model_space_t model_space;
+	init_default_model_space(&model_space);
+	bool found = false;
+	while (!found && next_model(&model_space)) {
+		if (strcmp(model_space.matrix_repr_short, matrix_repr_short) == 0) {
+			strcpy(matrix_repr, model_space.matrix_repr);
+			found = true;
+		}
+	}
+	destroy_model_space(&model_space);
+	return found;
+}
@@ -0,0 +1,109 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RESELECT_H
+#define RESELECT_H
+
+#include <stdbool.h>
+
+#include "ic.h"
+#include "pltb.h"
+#include "models.h"
+
+/**
+ * Offline model selection: recomputes information criteria from the likelihoods stored in result files
+ * (@see fprint_eval_row) instead of re-optimizing the models. Every criterion is -2 lnL + penalty(k, n),
+ * so the free parameters k and the sample sizes n are all it needs next to the likelihoods.
+ */
+
+/* a criterion over the alignment columns (-S) or the cells, i.e. columns times taxa (-M) */
+typedef struct {
+	char        *name;
+	ic_penalty_t penalty;
+	bool         per_cell;
+} pltb_criterion_t;
+
+/* AIC, AICc-S, AICc-M, BIC-S, BIC-M (as during the runs), HQC-S, HQC-M */
+#define N_CRITERIA 7
+
+/* @return the criterion of the given name (e.g. HQC-S) or NULL */
+const pltb_criterion_t *find_criterion( char *name );
+
+/* @return the criterion at index < N_CRITERIA */
+const pltb_criterion_t *get_criterion( unsigned index );
+
+/* the models of one result file in the order of its table */
+typedef struct {
+	unsigned  n_models;
+	char    (*models)[MODEL_MATRIX_REPRESENTATION_LENGTH_SHORT];
+	unsigned *K;
+	double   *likelihoods;
+	/* free parameters, derived from the stored likelihood & AIC */
+	double   *params;
+	/* the criteria as stored during the run */
+	double  (*stored)[IC_MAX];
+	/* the selection of the run per stored criterion */
+	char      selection[IC_MAX][MODEL_MATRIX_REPRESENTATION_LENGTH_SHORT];
+	/* the models the file holds a tree of */
+	unsigned  n_trees;
+	char    (*trees)[MODEL_MATRIX_REPRESENTATION_LENGTH_SHORT];
+	/* sample sizes: alignment columns & taxa */
+	unsigned  sites;
+	unsigned  taxa;
+} pltb_stored_result_t;
+
+/**
+ * Reads the evaluation table, its overview & the trees of a result file. The sample sizes
+ * are derived from the stored BIC values (@see derive_sample_sizes) unless overridden afterwards.
+ * @return false iff the file can't be read or holds no evaluation table
+ */
+bool read_stored_result( char *path, pltb_stored_result_t *result );
+
+void destroy_stored_result( pltb_stored_result_t *result );
+
+/**
+ * Recovers the number of alignment columns from the BIC-S and the number of taxa from the BIC-M values.
+ * Both are averaged in log space over all models, the rounding of the printed values cancels out.
+ */
+void derive_sample_sizes( pltb_stored_result_t *result );
+
+/**
+ * Computes all given criteria of all models, one pass over the stored likelihoods per criterion.
+ * values[c * n_models + i] is criterion c of model i, weights the same layout holds
+ * exp(-delta/2) normalized per criterion: Akaike weights resp. approximate posterior model probabilities.
+ */
+void compute_criteria( pltb_stored_result_t *result, const pltb_criterion_t **criteria, unsigned n_criteria,
+		double *values, double *weights );
+
+/* @return the index of the model minimizing the given values of one criterion */
+unsigned select_stored_model( double *values, unsigned n_models );
+
+bool has_stored_tree( pltb_stored_result_t *result, char *matrix_repr_short );
+
+/**
+ * Restores the seed & model variant of a run from the name of its result file,
+ * <prefix>-0x<seed>[-opt|-eq][-flat-gamma].result (@see output_file_name)
+ */
+void configure_from_file_name( pltb_config_t *config, char *path );
+
+/**
+ * Finds the long representation of a model of the default model space (@see models.h)
+ * @return false iff there is no such model
+ */
+bool find_matrix_repr( char *matrix_repr_short, char *matrix_repr );
+
+#endif
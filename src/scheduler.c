@@ -0,0 +1,94 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <string.h>
+#include <pll/pll.h>
+
+#include "scheduler.h"
+
+/* the branch lengths are optimized for all models alike */
+#define COST_MODEL_SHARED_PARAMS 1
+
+/* models predicted to take less (seconds) are handed out in chunks */
+#define CHUNK_TIME_THRESHOLD 0.01
+/* a chunk takes 1 / (factor * workers) of the remaining tasks, as guided self-scheduling does */
+#define GUIDED_CHUNK_FACTOR 2
+
+static double prior_units( pltb_cost_model_t *cost_model, unsigned K )
+{
+	/* K - 1 rates, alpha and the base frequencies (if optimized) */
+	unsigned params = COST_MODEL_SHARED_PARAMS + (K - 1) + cost_model->variant_params;
+	return cost_model->patterns_x_taxa * params;
+}
+
+void init_cost_model( pltb_cost_model_t *cost_model, pllAlignmentData *data, pltb_config_t *config )
+{
+	memset(cost_model, 0, sizeof(pltb_cost_model_t));
+	cost_model->patterns_x_taxa  = (double)data->sequenceLength * data->sequenceCount;
+	cost_model->variant_params   = count_variant_parameters(config);
+}
+
+double predict_cost( pltb_cost_model_t *cost_model, unsigned K )
+{
+	assert(K >= 1 && K <= MAX_FREE_PARAMETER_COUNT);
+	if (cost_model->observed_count[K - 1] > 0) {
+		return cost_model->observed_time[K - 1] / cost_model->observed_count[K - 1];
+	}
+	double scale = 1.0;
+	if (cost_model->observed_units_total > 0) {
+		scale = cost_model->observed_time_total / cost_model->observed_units_total;
+	}
+	return prior_units(cost_model, K) * scale;
+}
+
+void observe_cost( pltb_cost_model_t *cost_model, unsigned K, double time_real )
+{
+	assert(K >= 1 && K <= MAX_FREE_PARAMETER_COUNT);
+	cost_model->observed_time [K - 1] += time_real;
+	cost_model->observed_count[K - 1]++;
+	cost_model->observed_time_total  += time_real;
+	cost_model->observed_units_total += prior_units(cost_model, K);
+}
+
+unsigned guided_chunk_size( pltb_cost_model_t *cost_model, unsigned K, unsigned n_remaining, unsigned n_workers )
+{
+	/* without observations the prediction is in prior units */
+	if (cost_model->observed_units_total <= 0 || predict_cost(cost_model, K) >= CHUNK_TIME_THRESHOLD) {
+		return 1;
+	}
+	unsigned size = n_remaining / (GUIDED_CHUNK_FACTOR * n_workers);
+	return size < 1 ? 1 : size > MAX_CHUNK_SIZE ? MAX_CHUNK_SIZE : size;
+}
+
+double simulate_makespan( double *costs, unsigned n_costs, unsigned n_workers )
+{
+	double finish[n_workers];
+	memset(finish, 0, sizeof(finish));
+
+	double makespan = 0;
+	for (unsigned i = 0; i < n_costs; i++) {
+		/* the worker finishing first takes the next task */
+		unsigned first = 0;
+		for (unsigned j = 1; j < n_workers; j++) {
+			if (finish[j] < finish[first]) first = j;
+		}
+		finish[first] += costs[i];
+		if (finish[first] > makespan) makespan = finish[first];
+	}
+	return makespan;
+}
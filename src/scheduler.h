@@ -0,0 +1,70 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pll/pll.h>
+#include "models.h"
+#include "pltb.h"
+
+/* predicts the optimization time of a model, refined by the timings observed so far */
+typedef struct {
+	/* alignment dimensions, identical for all models */
+	double   patterns_x_taxa;
+	/* alpha and the base frequencies, as far as optimized (@see count_variant_parameters) */
+	unsigned variant_params;
+	/* observations per K (index K - 1) */
+	double   observed_time [MAX_FREE_PARAMETER_COUNT];
+	unsigned observed_count[MAX_FREE_PARAMETER_COUNT];
+	/* calibration of the prior */
+	double   observed_time_total;
+	double   observed_units_total;
+} pltb_cost_model_t;
+
+void init_cost_model( pltb_cost_model_t *cost_model, pllAlignmentData *data, pltb_config_t *config );
+
+/**
+ * Predicts the optimization time of a model with K rate classes.
+ * Uses the mean time of the models with the same K observed so far, otherwise the prior
+ * (free parameters times alignment dimensions) calibrated by all observations so far.
+ * Without any observation the result is in prior units, suitable for ordering only.
+ */
+double predict_cost( pltb_cost_model_t *cost_model, unsigned K );
+
+void observe_cost( pltb_cost_model_t *cost_model, unsigned K, double time_real );
+
+/* the most tasks handed to a worker at once (@see guided_chunk_size) */
+#define MAX_CHUNK_SIZE 8
+
+/**
+ * Guided self-scheduling: the number of tasks to hand out at once, so short models pay the
+ * round trip to the master once per chunk. Models predicted to finish within a few milliseconds
+ * go out in chunks of a share of the remaining tasks per worker, shrinking towards the end.
+ * @param n_remaining The tasks not dispatched yet
+ * @param n_workers The number of evaluating processes (and threads)
+ * @return 1 for longer models or without observations, otherwise up to MAX_CHUNK_SIZE
+ */
+unsigned guided_chunk_size( pltb_cost_model_t *cost_model, unsigned K, unsigned n_remaining, unsigned n_workers );
+
+/**
+ * Simulates the on demand distribution of tasks with the given costs in the given order.
+ * @return The time the last of n_workers workers finishes
+ */
+double simulate_makespan( double *costs, unsigned n_costs, unsigned n_workers );
+
+#endif
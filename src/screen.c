@@ -0,0 +1,76 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <float.h>
+
+#include "screen.h"
+
+double evaluation_epsilon( pltb_config_t *config, pllInstance *inst, bool refine )
+{
+	if (config->screen_epsilon > 0 && !refine) {
+		return config->screen_epsilon;
+	}
+	return inst->likelihoodEpsilon;
+}
+
+unsigned select_contenders( model_space_t *model_space, pltb_model_stat_t *stats, bool *screened,
+		double margin, unsigned *contenders )
+{
+	unsigned count = model_space->matrix_count;
+	double   leader[IC_MAX];
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		leader[i] = FLT_MAX;
+	}
+	for (unsigned j = 0; j < count; j++) {
+		if (screened != NULL && !screened[j]) continue;
+		for (unsigned i = 0; i < IC_MAX; i++) {
+			if (stats[j].ic[i] < leader[i]) {
+				leader[i] = stats[j].ic[i];
+			}
+		}
+	}
+
+	unsigned n_contenders = 0;
+	for (unsigned j = 0; j < count; j++) {
+		if (screened != NULL && !screened[j]) continue;
+		bool contender = false;
+		for (unsigned i = 0; i < IC_MAX; i++) {
+			contender = contender || stats[j].ic[i] <= leader[i] + margin;
+		}
+		if (contender) {
+			contenders[n_contenders++] = j;
+		}
+	}
+	return n_contenders;
+}
+
+void add_screening_time( pltb_model_stat_t *refined, pltb_model_stat_t *screened )
+{
+	refined->time_cpu  += screened->time_cpu;
+	refined->time_real += screened->time_real;
+}
+
+void collect_result( model_space_t *model_space, pltb_model_stat_t *stats, bool *screened, pltb_result_t *result )
+{
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		result->ic[i] = FLT_MAX;
+	}
+	for (unsigned j = 0; j < model_space->matrix_count; j++) {
+		if (screened != NULL && !screened[j]) continue;
+		merge_into_result(result, &stats[j], j);
+	}
+}
@@ -0,0 +1,59 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdbool.h>
+#include "models.h"
+#include "pltb.h"
+
+/**
+ * Two-stage screening: all models are optimized with a loose convergence threshold
+ * (config->screen_epsilon) first, then the contenders, the models within config->screen_margin
+ * of the leader of any information criterion, are re-optimized at full precision.
+ */
+
+/**
+ * The convergence threshold of a model evaluation: the loose one while screening,
+ * the one of the instance otherwise.
+ * @param refine The evaluation re-optimizes a contender
+ */
+double evaluation_epsilon( pltb_config_t *config, pllInstance *inst, bool refine );
+
+/**
+ * Selects the contenders among the screened models.
+ * @param stats Per (relative) model
+ * @param screened Flags per model, NULL => all models have been screened
+ * @param contenders Destination of up to model_space->matrix_count (relative) models, in model order
+ * @return The number of contenders
+ */
+unsigned select_contenders( model_space_t *model_space, pltb_model_stat_t *stats, bool *screened,
+		double margin, unsigned *contenders );
+
+/**
+ * Adds the screening time of a model to its refined statistics, the summary reports the time of both stages.
+ */
+void add_screening_time( pltb_model_stat_t *refined, pltb_model_stat_t *screened );
+
+/**
+ * Merges the models into a fresh result in model order, replacing the screening results of the contenders.
+ * @param screened Flags per model, NULL => all models
+ */
+void collect_result( model_space_t *model_space, pltb_model_stat_t *stats, bool *screened, pltb_result_t *result );
+
+#endif
@@ -16,9 +16,16 @@
  * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+#include "climb.h"
 #include "debug.h"
+#include "journal.h"
 #include "pltb.h"
 #include "pltb_frontend.h"
+#include "screen.h"
+#include "sink.h"
 
 #include "sequential.h"
 
@@ -28,21 +35,35 @@
 #include "time.h"
 #endif
 
-#define DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT stdout
+#define DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT config->output
 #define DEBUG_PROCESS_STATISTICS_CLOSE_OUTPUT(f)
 //#define DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT fopen("performance.txt", "w")
 //#define DEBUG_PROCESS_STATISTICS_CLOSE_OUTPUT(f) fclose(f)
 
-int run_sequential( char *dataset_file, pltb_config_t *config, model_space_t *model_space )
+int run_sequential( pltb_dataset_t *dataset, char *start_tree, pltb_config_t *config, model_space_t *model_space )
 {
 	FILE *out = DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT;
 	pltb_model_stat_t stats[model_space->matrix_count];
 
 	TIME_STRUCT_INIT(timer);
+	TIME_STRUCT_INIT(phase);
+	pltb_counter_sample_t counters;
+
+	pllAlignmentData *data = dataset->data;
+
+	/* the models preloaded from the journal & cache are skipped (@see preload_model) */
+	uint64_t alignment_fingerprint = dataset->fingerprint;
+	uint64_t config_fingerprint    = fingerprint_config(config);
+	pltb_cache_t   cache;
+	pltb_journal_t journal;
+	if ((config->cache_dir != NULL && init_cache(&cache, config->cache_dir,
+				alignment_fingerprint, config_fingerprint, model_space) != 0)
+			|| (config->journal_file != NULL && open_journal(&journal, config->journal_file,
+				alignment_fingerprint, config_fingerprint, model_space) != 0)) {
+		return 1;
+	}
 
-	fprint_eval_header(out);
-
-	pllAlignmentData *data = read_alignment_data(dataset_file);
+	fprint_eval_header(out, config);
 
 	pltb_result_t result;
 
@@ -50,34 +71,148 @@ int run_sequential( char *dataset_file, pltb_config_t *config, model_space_t *mo
 		result.ic[i] = FLT_MAX;
 	}
 
-	while (next_model(model_space)) {
-		partitionList *parts = init_partitions(data, config->base_freq_kind);
-		pllInstance *inst = setup_instance(model_space->matrix_repr, &config->attr_model_eval, data, parts);
+	/* one starting tree for all models */
+	pltb_eval_context_t context;
+	PHASE_START(phase);
+	init_eval_context(&context, &config->attr_model_eval, data, config->base_freq_kind, config->rate_het, start_tree);
+	PHASE_END(config->profile, PHASE_SETUP, phase);
+
+	/* parents precede their children in the model space, so they are always evaluated first */
+	bool     evaluated[model_space->matrix_count];
+	unsigned warm_length = warm_start_length(data->sequenceCount);
+	double  *warm_states = NULL;
+	if (config->warm_start) {
+		warm_states = malloc(sizeof(double) * warm_length * model_space->matrix_count);
+	}
+	memset(evaluated, 0, sizeof(evaluated));
+
+	/* all models in one go or the frontiers of a greedy climb one after another */
+	unsigned     all_models[model_space->matrix_count];
+	pltb_climb_t climb;
+	for (unsigned i = 0; i < model_space->matrix_count; i++) {
+		all_models[i] = i;
+	}
+	if (config->greedy_climb) {
+		init_climb(&climb, model_space);
+		/* the models left out don't add to the summary */
+		memset(stats, 0, sizeof(stats));
+	}
+	/* screening results are preliminary, the rows are printed once the contenders are refined */
+	bool screening = config->screen_epsilon > 0;
+
+	do {
+		unsigned *round   = config->greedy_climb ? climb.frontier   : all_models;
+		unsigned  n_round = config->greedy_climb ? climb.n_frontier : model_space->matrix_count;
+		for (unsigned r = 0; r < n_round; r++) {
+			set_model(model_space, round[r]);
+			pltb_model_stat_t *stat = &stats[model_space->matrix_index];
+			if (preload_model(config, model_space, data, config->journal_file != NULL ? &journal : NULL,
+						config->cache_dir != NULL ? &cache : NULL, stat, &result, out)) continue;
+
+			unsigned parent;
+			PHASE_START(phase);
+			if (config->warm_start && select_warm_start_parent(model_space, model_space->matrix_index,
+						evaluated, stats, &parent)) {
+				warm_start_eval_context(&context, model_space->matrix_repr, &warm_states[parent * warm_length]);
+			} else {
+				reset_eval_context(&context, model_space->matrix_repr);
+			}
+			PHASE_END(config->profile, PHASE_RESET, phase);
+
+			stat->matrix_index = model_space->matrix_index;
+			sample_counters(&counters);
+			TIME_START(timer);
+
+			optimize_model_parameters(context.inst, context.parts, evaluation_epsilon(config, context.inst, false));
+
+			TIME_END(timer);
+			add_model_counters(config->profile, absolute_model_index(model_space, model_space->matrix_index), &counters);
+			stat->time_cpu  = TIME_CPU(timer);
+			stat->time_real = TIME_REAL(timer);
+			add_phase(config->profile, PHASE_OPTIMIZE, stat->time_cpu, stat->time_real);
+
+			stat->likelihood = context.inst->likelihood;
+			calculate_model_ICs(stat, data, model_space->free_parameter_count, config);
+			merge_into_result(&result, stat, model_space->matrix_index);
+			if (config->journal_file != NULL) {
+				append_journal(&journal, stat);
+			}
+			if (config->cache_dir != NULL) {
+				store_cache(&cache, stat);
+			}
+
+			if (config->warm_start) {
+				save_warm_start(&context, &warm_states[model_space->matrix_index * warm_length]);
+			}
+			evaluated[model_space->matrix_index] = true;
+
+			if (config->sink != NULL) {
+				sink_model(config->sink, config, model_space->matrix_repr_short, model_space->K, stat,
+				           screening ? "screening" : "full", false);
+			}
+			if (!screening) {
+				fprint_eval_row(out, model_space, stat);
+			}
+		}
+	} while (config->greedy_climb && advance_climb(&climb, stats));
+
+	/* re-optimize the contenders at full precision, starting from their screening optimum (if kept) */
+	bool    *screened = config->greedy_climb ? climb.evaluated : NULL;
+	unsigned contenders[model_space->matrix_count];
+	unsigned n_contenders = 0;
+	if (screening) {
+		n_contenders = select_contenders(model_space, stats, screened, config->screen_margin, contenders);
+	}
+	for (unsigned r = 0; r < n_contenders; r++) {
+		set_model(model_space, contenders[r]);
+		pltb_model_stat_t *stat          = &stats[model_space->matrix_index];
+		pltb_model_stat_t  screened_stat = *stat;
+
+		PHASE_START(phase);
+		if (config->warm_start && evaluated[model_space->matrix_index]) {
+			warm_start_eval_context(&context, model_space->matrix_repr,
+			                        &warm_states[model_space->matrix_index * warm_length]);
+		} else {
+			reset_eval_context(&context, model_space->matrix_repr);
+		}
+		PHASE_END(config->profile, PHASE_RESET, phase);
 
-		pltb_model_stat_t *stat = &stats[model_space->matrix_index];
 		stat->matrix_index = model_space->matrix_index;
+		sample_counters(&counters);
 		TIME_START(timer);
 
-		optimize_model_parameters(inst, parts);
+		optimize_model_parameters(context.inst, context.parts, evaluation_epsilon(config, context.inst, true));
 
 		TIME_END(timer);
+		add_model_counters(config->profile, absolute_model_index(model_space, model_space->matrix_index), &counters);
 		stat->time_cpu  = TIME_CPU(timer);
 		stat->time_real = TIME_REAL(timer);
+		add_phase(config->profile, PHASE_OPTIMIZE, stat->time_cpu, stat->time_real);
+		add_screening_time(stat, &screened_stat);
+
+		stat->likelihood = context.inst->likelihood;
+		calculate_model_ICs(stat, data, model_space->free_parameter_count, config);
+		if (config->sink != NULL) {
+			sink_model(config->sink, config, model_space->matrix_repr_short, model_space->K, stat, "refined", false);
+		}
+	}
+	if (screening) {
+		collect_result(model_space, stats, screened, &result);
+	}
+	destroy_eval_context(&context);
+	free(warm_states);
+	if (config->journal_file != NULL) {
+		close_journal(&journal);
+	}
 
-		stat->likelihood = inst->likelihood;
-		calculate_model_ICs(stat, data, inst, model_space->free_parameter_count, config);
-		merge_into_result(&result, stat, model_space->matrix_index);
-
-		fprint_eval_row(out, model_space, stat);
-
-		pllPartitionsDestroy(inst, &parts);
-		pllDestroyInstance(inst);
+	/* the rows of a screening are printed once refined */
+	report_eval_results(out, config, model_space, stats, screening, &result,
+	                    config->greedy_climb ? &climb : NULL, contenders, n_contenders);
+	if (config->greedy_climb) {
+		destroy_climb(&climb);
 	}
-	fprint_eval_summary(out, model_space, &stats, &result);
 	DEBUG_PROCESS_STATISTICS_CLOSE_OUTPUT(out);
 
-	evaluate_result(model_space, &result, data, config);
-
-	pllAlignmentDataDestroy(data);
+	evaluate_result(model_space, &result, data, config, start_tree);
 	return 0;
 }
@@ -21,6 +21,11 @@
 #include "pltb.h"
 #include "models.h"
 
-int run_sequential( char *dataset_file, pltb_config_t *config, model_space_t *model_space );
+/**
+ * Evaluates one model after another.
+ * @param dataset The MSA shared by the configurations of the dataset
+ * @param start_tree The starting tree of the configuration (@see pltb_dataset_t)
+ */
+int run_sequential( pltb_dataset_t *dataset, char *start_tree, pltb_config_t *config, model_space_t *model_space );
 
 #endif
@@ -0,0 +1,377 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pltb_frontend.h"
+#include "sink.h"
+
+/* the columns of all record types, unused ones stay empty */
+enum {
+	COLUMN_TYPE,
+	COLUMN_DATASET,
+	COLUMN_SEED,
+	COLUMN_BASE_FREQS,
+	COLUMN_RATE_HET,
+	COLUMN_MODEL,
+	COLUMN_K,
+	COLUMN_STAGE,
+	COLUMN_PRELOADED,
+	COLUMN_LIKELIHOOD,
+	COLUMN_IC,
+	COLUMN_TIME_CPU = COLUMN_IC + IC_MAX,
+	COLUMN_TIME_REAL,
+	COLUMN_CRITERION,
+	COLUMN_VALUE,
+	COLUMN_NEWICK,
+	COLUMN_PHASE,
+	COLUMN_PROCESS,
+	COLUMN_COUNT,
+	COLUMN_COUNTER,
+	COLUMN_MAX = COLUMN_COUNTER + COUNTER_MAX
+};
+
+/* a value per column or NULL, formatted as JSON literal (numbers & booleans) or raw string */
+typedef struct {
+	char *values[COLUMN_MAX];
+	bool  strings[COLUMN_MAX];
+} sink_record_t;
+
+static const char *column_name(unsigned column)
+{
+	static const char *names[] = { "type", "dataset", "seed", "base_freqs", "rate_het", "model", "K", "stage",
+	                               "preloaded", "likelihood" };
+	static const char *times[] = { "time_cpu", "time_real", "criterion", "value", "newick",
+	                               "phase", "process", "count" };
+	if (column < COLUMN_IC) return names[column];
+	if (column < COLUMN_TIME_CPU) return get_IC_name_short(column - COLUMN_IC);
+	if (column >= COLUMN_COUNTER) return get_counter_name(column - COLUMN_COUNTER);
+	return times[column - COLUMN_TIME_CPU];
+}
+
+static void set_string(sink_record_t *record, unsigned column, const char *value)
+{
+	record->values[column]  = strdup(value);
+	record->strings[column] = true;
+}
+
+static void set_literal(sink_record_t *record, unsigned column, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+static void set_literal(sink_record_t *record, unsigned column, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+
+	record->values[column] = malloc((size_t)length + 1);
+	va_start(args, fmt);
+	vsnprintf(record->values[column], (size_t)length + 1, fmt, args);
+	va_end(args);
+	record->strings[column] = false;
+}
+
+/* type and the identity of the configuration, common to all records */
+static void init_record(sink_record_t *record, const char *type, pltb_config_t *config)
+{
+	memset(record, 0, sizeof(*record));
+	set_string(record, COLUMN_TYPE, type);
+	set_string(record, COLUMN_DATASET, config->dataset_file != NULL ? config->dataset_file : "");
+	set_literal(record, COLUMN_SEED, "%ld", (long)config->attr_model_eval.randomNumberSeed);
+	set_string(record, COLUMN_BASE_FREQS, base_freq_name(config->base_freq_kind));
+	set_string(record, COLUMN_RATE_HET, rate_het_name(config->rate_het));
+}
+
+static void fprint_json_string(FILE *f, const char *value)
+{
+	fputc('"', f);
+	for (const unsigned char *c = (const unsigned char*)value; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(f, "\\%c", *c);
+		} else if (*c < 0x20) {
+			fprintf(f, "\\u%04x", *c);
+		} else {
+			fputc(*c, f);
+		}
+	}
+	fputc('"', f);
+}
+
+static void fprint_csv_value(FILE *f, const char *value)
+{
+	if (strpbrk(value, ",\"\n\r") == NULL) {
+		fputs(value, f);
+		return;
+	}
+	fputc('"', f);
+	for (const char *c = value; *c != '\0'; c++) {
+		if (*c == '"') fputc('"', f);
+		fputc(*c, f);
+	}
+	fputc('"', f);
+}
+
+/* hands the formatted record to the writer, destroying it */
+static void submit_record(pltb_sink_t *sink, sink_record_t *record)
+{
+	char  *text = NULL;
+	size_t size = 0;
+	FILE  *f    = open_memstream(&text, &size);
+	bool   first = true;
+
+	if (sink->format == SINK_JSONL) fputc('{', f);
+	for (unsigned i = 0; i < COLUMN_MAX; i++) {
+		if (sink->format == SINK_CSV) {
+			if (i > 0) fputc(',', f);
+			if (record->values[i] != NULL) fprint_csv_value(f, record->values[i]);
+		} else if (record->values[i] != NULL) {
+			if (!first) fputc(',', f);
+			fprint_json_string(f, column_name(i));
+			fputc(':', f);
+			if (record->strings[i]) {
+				fprint_json_string(f, record->values[i]);
+			} else {
+				fputs(record->values[i], f);
+			}
+			first = false;
+		}
+		free(record->values[i]);
+	}
+	if (sink->format == SINK_JSONL) fputc('}', f);
+	fputc('\n', f);
+	fclose(f);
+
+	sink_line_t *line = malloc(sizeof(sink_line_t) + size + 1);
+	line->next = NULL;
+	memcpy(line->text, text, size + 1);
+	free(text);
+
+	pthread_mutex_lock(&sink->mutex);
+	if (sink->tail != NULL) {
+		sink->tail->next = line;
+	} else {
+		sink->head = line;
+	}
+	sink->tail = line;
+	pthread_cond_signal(&sink->cond);
+	pthread_mutex_unlock(&sink->mutex);
+}
+
+static void *run_sink_writer(void *arg)
+{
+	pltb_sink_t *sink = arg;
+
+	pthread_mutex_lock(&sink->mutex);
+	while (true) {
+		while (sink->head == NULL && !sink->stop) {
+			pthread_cond_wait(&sink->cond, &sink->mutex);
+		}
+		if (sink->head == NULL) break;
+
+		/* take all records at once, the producers go on meanwhile */
+		sink_line_t *lines = sink->head;
+		sink->head = NULL;
+		sink->tail = NULL;
+		pthread_mutex_unlock(&sink->mutex);
+
+		while (lines != NULL) {
+			sink_line_t *next = lines->next;
+			fputs(lines->text, sink->file);
+			free(lines);
+			lines = next;
+		}
+		/* readers act on partial results */
+		fflush(sink->file);
+
+		pthread_mutex_lock(&sink->mutex);
+	}
+	pthread_mutex_unlock(&sink->mutex);
+	return NULL;
+}
+
+int open_sink( pltb_sink_t *sink, char *path, pltb_sink_format_t format )
+{
+	sink->file = fopen(path, "w");
+	if (sink->file == NULL) {
+		perror(path);
+		return 1;
+	}
+	sink->format = format;
+	sink->head   = NULL;
+	sink->tail   = NULL;
+	sink->stop   = false;
+	if (format == SINK_CSV) {
+		for (unsigned i = 0; i < COLUMN_MAX; i++) {
+			fprintf(sink->file, i > 0 ? ",%s" : "%s", column_name(i));
+		}
+		fputc('\n', sink->file);
+	}
+	pthread_mutex_init(&sink->mutex, NULL);
+	pthread_cond_init(&sink->cond, NULL);
+	pthread_create(&sink->thread, NULL, &run_sink_writer, sink);
+	return 0;
+}
+
+void close_sink( pltb_sink_t *sink )
+{
+	pthread_mutex_lock(&sink->mutex);
+	sink->stop = true;
+	pthread_cond_signal(&sink->cond);
+	pthread_mutex_unlock(&sink->mutex);
+	pthread_join(sink->thread, NULL);
+	pthread_cond_destroy(&sink->cond);
+	pthread_mutex_destroy(&sink->mutex);
+	fclose(sink->file);
+}
+
+void sink_model( pltb_sink_t *sink, pltb_config_t *config, char *matrix_repr_short, unsigned K,
+		pltb_model_stat_t *stat, const char *stage, bool preloaded )
+{
+	sink_record_t record;
+	init_record(&record, "model", config);
+	set_string(&record, COLUMN_MODEL, matrix_repr_short);
+	set_literal(&record, COLUMN_K, "%u", K);
+	set_string(&record, COLUMN_STAGE, stage);
+	set_literal(&record, COLUMN_PRELOADED, "%s", preloaded ? "true" : "false");
+	set_literal(&record, COLUMN_LIKELIHOOD, "%.17g", stat->likelihood);
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		set_literal(&record, COLUMN_IC + i, "%.17g", stat->ic[i]);
+	}
+	set_literal(&record, COLUMN_TIME_CPU, "%.6f", stat->time_cpu);
+	set_literal(&record, COLUMN_TIME_REAL, "%.6f", stat->time_real);
+	submit_record(sink, &record);
+}
+
+void sink_profile( pltb_sink_t *sink, pltb_profile_t *profiles, unsigned n_processes )
+{
+	for (unsigned p = 0; p < n_processes; p++) {
+		for (unsigned i = 0; i < PHASE_MAX; i++) {
+			if (profiles[p].count[i] == 0) continue;
+			/* of the whole run, no configuration */
+			sink_record_t record;
+			memset(&record, 0, sizeof(record));
+			set_string(&record, COLUMN_TYPE, "phase");
+			set_string(&record, COLUMN_PHASE, get_phase_name(i));
+			set_literal(&record, COLUMN_PROCESS, "%u", p);
+			set_literal(&record, COLUMN_COUNT, "%lu", (unsigned long)profiles[p].count[i]);
+			set_literal(&record, COLUMN_TIME_CPU, "%.6f", profiles[p].cpu[i]);
+			set_literal(&record, COLUMN_TIME_REAL, "%.6f", profiles[p].real[i]);
+			submit_record(sink, &record);
+		}
+	}
+}
+
+/* the counters available, summed over all processes */
+static void set_counters(sink_record_t *record, uint64_t *counters, uint32_t available)
+{
+	for (unsigned i = 0; i < COUNTER_MAX; i++) {
+		if (available & (1u << i)) {
+			set_literal(record, COLUMN_COUNTER + i, "%llu", (unsigned long long)counters[i]);
+		}
+	}
+}
+
+void sink_counters( pltb_sink_t *sink, pltb_profile_t *profiles, unsigned n_processes )
+{
+	pltb_profile_t total;
+	init_profile(&total);
+	for (unsigned p = 0; p < n_processes; p++) {
+		merge_profile(&total, &profiles[p]);
+	}
+
+	model_space_t model_space;
+	init_default_model_space(&model_space);
+	for (unsigned m = 0; m < MAX_MATRIX_INDEX; m++) {
+		uint64_t *counters = total.model_counters[m];
+		if (counters[COUNTER_CYCLES] == 0 && counters[COUNTER_INSTRUCTIONS] == 0) continue;
+		set_model(&model_space, m);
+		sink_record_t record;
+		memset(&record, 0, sizeof(record));
+		set_string(&record, COLUMN_TYPE, "counters");
+		set_string(&record, COLUMN_PHASE, get_phase_name(PHASE_OPTIMIZE));
+		set_string(&record, COLUMN_MODEL, model_space.matrix_repr_short);
+		set_literal(&record, COLUMN_K, "%u", model_space.K);
+		set_counters(&record, counters, total.counters_available);
+		submit_record(sink, &record);
+	}
+	destroy_model_space(&model_space);
+
+	sink_record_t record;
+	memset(&record, 0, sizeof(record));
+	set_string(&record, COLUMN_TYPE, "counters");
+	set_string(&record, COLUMN_PHASE, get_phase_name(PHASE_TREE_SEARCH));
+	set_counters(&record, total.tree_counters, total.counters_available);
+	submit_record(sink, &record);
+}
+
+void sink_selection( pltb_sink_t *sink, pltb_config_t *config, model_space_t *model_space, pltb_result_t *result )
+{
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		sink_record_t record;
+		init_record(&record, "selection", config);
+		set_model(model_space, result->matrix_index[i]);
+		set_string(&record, COLUMN_MODEL, model_space->matrix_repr_short);
+		set_literal(&record, COLUMN_K, "%u", model_space->K);
+		set_string(&record, COLUMN_CRITERION, get_IC_name_short(i));
+		set_literal(&record, COLUMN_VALUE, "%.17g", result->ic[i]);
+		submit_record(sink, &record);
+	}
+}
+
+void sink_joint_selection( pltb_sink_t *sink, model_space_t *model_space, pltb_config_t *variants, unsigned n_variants )
+{
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		unsigned joint = select_joint_variant(variants, n_variants, i);
+		if (joint == n_variants) continue;
+		pltb_config_t *winner = &variants[joint];
+		sink_record_t record;
+		init_record(&record, "joint", winner);
+		set_model(model_space, winner->selection.matrix_index[i]);
+		set_string(&record, COLUMN_MODEL, model_space->matrix_repr_short);
+		set_literal(&record, COLUMN_K, "%u", model_space->K);
+		set_string(&record, COLUMN_CRITERION, get_IC_name_short(i));
+		set_literal(&record, COLUMN_VALUE, "%.17g", winner->selection.ic[i]);
+		submit_record(sink, &record);
+	}
+}
+
+void sink_tree( pltb_sink_t *sink, pltb_config_t *config, char *matrix_repr_short,
+		pltb_result_t *result, unsigned model, char *newick )
+{
+	/* the criteria selecting the model, none => an extra model */
+	char criteria[IC_MAX * 8] = "";
+	for (unsigned i = 0; i < IC_MAX; i++) {
+		if (result->matrix_index[i] != model) continue;
+		if (criteria[0] != '\0') strcat(criteria, " ");
+		strcat(criteria, get_IC_name_short(i));
+	}
+
+	sink_record_t record;
+	init_record(&record, "tree", config);
+	set_string(&record, COLUMN_MODEL, matrix_repr_short);
+	set_string(&record, COLUMN_CRITERION, criteria[0] != '\0' ? criteria : "extra");
+	/* without the line break of the textual output */
+	set_string(&record, COLUMN_NEWICK, newick);
+	char *end = record.values[COLUMN_NEWICK] + strlen(record.values[COLUMN_NEWICK]);
+	while (end > record.values[COLUMN_NEWICK] && (end[-1] == '\n' || end[-1] == '\r')) {
+		*--end = '\0';
+	}
+	submit_record(sink, &record);
+}
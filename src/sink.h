@@ -0,0 +1,107 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SINK_H
+#define SINK_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "pltb.h"
+
+typedef enum {
+	/* one JSON object per line */
+	SINK_JSONL,
+	/* one row per record, the columns of all record types */
+	SINK_CSV
+} pltb_sink_format_t;
+
+typedef struct sink_line {
+	struct sink_line *next;
+	char              text[];
+} sink_line_t;
+
+/**
+ * Machine-readable records of the results, written as they come in: one per evaluated model,
+ * one per selection of an information criterion, one per tree and (if profiled) one per phase
+ * & hardware counter summary. The records are formatted by the
+ * producing thread and written by a thread of their own, flushed whenever it runs out of records.
+ */
+typedef struct pltb_sink {
+	FILE              *file;
+	pltb_sink_format_t format;
+	pthread_t          thread;
+	pthread_mutex_t    mutex;
+	pthread_cond_t     cond;
+	/* protected by mutex: formatted records not written yet, oldest first */
+	sink_line_t       *head;
+	sink_line_t       *tail;
+	bool               stop;
+} pltb_sink_t;
+
+/**
+ * Creates the file and starts the writer. Don't forget to close the sink after use.
+ * @return 0 on success, 1 iff the file can't be created
+ */
+int open_sink( pltb_sink_t *sink, char *path, pltb_sink_format_t format );
+
+/* writes the outstanding records and stops the writer */
+void close_sink( pltb_sink_t *sink );
+
+/**
+ * Records the evaluation of a model. Thread-safe, like all records.
+ * @param stage "full", or "screening" & "refined" for the two stages of a screening (@see screen.h)
+ * @param preloaded The model has been taken from a journal or cache
+ */
+void sink_model( pltb_sink_t *sink, pltb_config_t *config, char *matrix_repr_short, unsigned K,
+		pltb_model_stat_t *stat, const char *stage, bool preloaded );
+
+/**
+ * Records the phases of a run (@see profile.h), one record per process & phase.
+ * @param profiles One per process, the master's first
+ */
+void sink_profile( pltb_sink_t *sink, pltb_profile_t *profiles, unsigned n_processes );
+
+/**
+ * Records the hardware counters (@see counters.h) summed over all processes: one record per model
+ * counted and one for the tree searches.
+ * @param profiles One per process
+ */
+void sink_counters( pltb_sink_t *sink, pltb_profile_t *profiles, unsigned n_processes );
+
+/**
+ * Records the selected model of every information criterion.
+ * @param result With relative model indices (before prepare_tree_searches)
+ */
+void sink_selection( pltb_sink_t *sink, pltb_config_t *config, model_space_t *model_space, pltb_result_t *result );
+
+/**
+ * Records the joint selection over the variants of a dataset & seed per information criterion
+ * (@see select_joint_variant), named after the winning variant. None iff all variants are approximate.
+ * @param variants The evaluated configurations of the variants
+ */
+void sink_joint_selection( pltb_sink_t *sink, model_space_t *model_space, pltb_config_t *variants, unsigned n_variants );
+
+/**
+ * Records the tree of a selected (or extra) model.
+ * @param result With absolute model indices (@see prepare_tree_searches)
+ * @param model The absolute model index
+ */
+void sink_tree( pltb_sink_t *sink, pltb_config_t *config, char *matrix_repr_short,
+		pltb_result_t *result, unsigned model, char *newick );
+
+#endif
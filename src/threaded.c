@@ -0,0 +1,368 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "cache.h"
+#include "climb.h"
+#include "debug.h"
+#include "journal.h"
+#include "pltb.h"
+#include "pltb_frontend.h"
+#include "screen.h"
+#include "sink.h"
+#include "scheduler.h"
+
+#include "threaded.h"
+
+#ifdef __APPLE__
+#include "time_mach.h"
+#else
+#include "time.h"
+#endif
+
+#define DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT config->output
+#define DEBUG_PROCESS_STATISTICS_CLOSE_OUTPUT(f)
+
+/* state shared by all evaluation threads */
+typedef struct {
+	model_space_t     *model_space;
+	pllAlignmentData  *data;
+	pltb_config_t     *config;
+	/* (relative) model indices in dispatch order */
+	unsigned          *order;
+	unsigned           n_order;
+	/* next position in order, advanced atomically */
+	unsigned           next;
+	/* the models in order are contenders of a screening, re-optimized at full precision */
+	bool               refine;
+	/* NULL => no journal */
+	pltb_journal_t    *journal;
+	pthread_mutex_t    journal_mutex;
+	/* NULL => no cache */
+	pltb_cache_t      *cache;
+	/* one entry per model, each written by exactly one thread */
+	pltb_model_stat_t *stats;
+	/* warm start: protected by warm_mutex, set after the model's state has been stored */
+	bool              *evaluated;
+	/* warm start: the models in order, the parents a model waits for (@see wait_for_parent) */
+	bool              *scheduled;
+	pthread_mutex_t    warm_mutex;
+	pthread_cond_t     warm_cond;
+	double            *warm_states;
+	unsigned           warm_length;
+} shared_state_t;
+
+typedef struct {
+	pthread_t            thread;
+	pltb_eval_context_t  context;
+	model_space_t        model_space;
+	shared_state_t      *shared;
+	/* merged into the profile of the configuration (if any) once the thread is done */
+	pltb_profile_t       profile;
+} eval_thread_t;
+
+/**
+ * Waits until all parents of the model scheduled in this run are evaluated and picks the best one,
+ * just like the sequential version. The parents precede the model in the dispatch order, so each of
+ * them is being evaluated by another thread already (or done).
+ */
+static bool wait_for_parent(shared_state_t *shared, model_space_t *model_space,
+		unsigned index, unsigned *parent)
+{
+	unsigned parents[MAX_PARENT_MODELS];
+	unsigned n_parents = parent_models(model_space, index, parents);
+	pthread_mutex_lock(&shared->warm_mutex);
+	for (unsigned i = 0; i < n_parents; i++) {
+		while (shared->scheduled[parents[i]] && !shared->evaluated[parents[i]]) {
+			pthread_cond_wait(&shared->warm_cond, &shared->warm_mutex);
+		}
+	}
+	bool found = select_warm_start_parent(model_space, index, shared->evaluated, shared->stats, parent);
+	pthread_mutex_unlock(&shared->warm_mutex);
+	return found;
+}
+
+static void *run_eval_thread(void *arg)
+{
+	eval_thread_t  *self   = arg;
+	shared_state_t *shared = self->shared;
+	model_space_t  *model_space = &self->model_space;
+	pltb_profile_t *profile     = shared->config->profile != NULL ? &self->profile : NULL;
+	TIME_STRUCT_INIT(timer);
+	TIME_STRUCT_INIT(phase);
+	pltb_counter_sample_t counters;
+
+	while (true) {
+		unsigned position = __atomic_fetch_add(&shared->next, 1, __ATOMIC_RELAXED);
+		if (position >= shared->n_order) break;
+		unsigned index = shared->order[position];
+
+		unsigned parent;
+		bool     warm = false;
+		if (shared->config->warm_start && !shared->refine) {
+			PHASE_START(phase);
+			warm = wait_for_parent(shared, model_space, index, &parent);
+			PHASE_END(profile, PHASE_WAIT, phase);
+		}
+		set_model(model_space, index);
+		PHASE_START(phase);
+		if (shared->refine) {
+			/* from the own screening optimum (if kept), the states are complete by now */
+			if (shared->config->warm_start && shared->evaluated[index]) {
+				warm_start_eval_context(&self->context, model_space->matrix_repr,
+				                        &shared->warm_states[index * shared->warm_length]);
+			} else {
+				reset_eval_context(&self->context, model_space->matrix_repr);
+			}
+		} else if (warm) {
+			warm_start_eval_context(&self->context, model_space->matrix_repr,
+			                        &shared->warm_states[parent * shared->warm_length]);
+		} else {
+			reset_eval_context(&self->context, model_space->matrix_repr);
+		}
+		PHASE_END(profile, PHASE_RESET, phase);
+
+		pltb_model_stat_t *stat     = &shared->stats[index];
+		pltb_model_stat_t  screened = *stat;
+		stat->matrix_index = index;
+		sample_counters(&counters);
+		TIME_START(timer);
+
+		optimize_model_parameters(self->context.inst, self->context.parts,
+		                          evaluation_epsilon(shared->config, self->context.inst, shared->refine));
+
+		TIME_END(timer);
+		add_model_counters(profile, absolute_model_index(model_space, index), &counters);
+		stat->time_cpu  = TIME_CPU(timer);
+		stat->time_real = TIME_REAL(timer);
+		add_phase(profile, PHASE_OPTIMIZE, stat->time_cpu, stat->time_real);
+
+		stat->likelihood = self->context.inst->likelihood;
+		calculate_model_ICs(stat, shared->data, model_space->free_parameter_count, shared->config);
+
+		/* journal & cache hold the screening results */
+		if (shared->refine) {
+			add_screening_time(stat, &screened);
+		}
+		if (shared->config->sink != NULL) {
+			sink_model(shared->config->sink, shared->config, model_space->matrix_repr_short, model_space->K, stat,
+			           shared->refine ? "refined" : shared->config->screen_epsilon > 0 ? "screening" : "full", false);
+		}
+		if (shared->refine) continue;
+
+		if (shared->journal != NULL) {
+			pthread_mutex_lock(&shared->journal_mutex);
+			append_journal(shared->journal, stat);
+			pthread_mutex_unlock(&shared->journal_mutex);
+		}
+		if (shared->cache != NULL) {
+			store_cache(shared->cache, stat);
+		}
+
+		if (shared->config->warm_start) {
+			save_warm_start(&self->context, &shared->warm_states[index * shared->warm_length]);
+			pthread_mutex_lock(&shared->warm_mutex);
+			shared->evaluated[index] = true;
+			pthread_cond_broadcast(&shared->warm_cond);
+			pthread_mutex_unlock(&shared->warm_mutex);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Puts the given models into dispatch order for the next run of the evaluation threads,
+ * leaving out the journaled & cached ones (done already, but provide no warm start state).
+ * @param models Relative model indices in model order
+ */
+static void schedule_models(shared_state_t *shared, model_space_t *model_space,
+		unsigned *models, unsigned n_models, pltb_cost_model_t *cost_model)
+{
+	unsigned *order = shared->order;
+
+	if (shared->config->warm_start) {
+		/* parents precede their children in the model space */
+		memcpy(order, models, sizeof(unsigned) * n_models);
+	} else {
+		/* longest task first (stable insertion sort by predicted cost) */
+		double cost[model_space->matrix_count];
+		for (unsigned i = 0; i < n_models; i++) {
+			unsigned index = models[i];
+			set_model(model_space, index);
+			cost[index] = predict_cost(cost_model, model_space->K);
+			unsigned j = i;
+			for (; j > 0 && cost[order[j - 1]] < cost[index]; j--) {
+				order[j] = order[j - 1];
+			}
+			order[j] = index;
+		}
+	}
+
+	shared->next    = 0;
+	shared->n_order = 0;
+	memset(shared->scheduled, 0, sizeof(bool) * model_space->matrix_count);
+	for (unsigned i = 0; i < n_models; i++) {
+		unsigned index = order[i];
+		set_model(model_space, index);
+		/* merged & printed in model order once all models are done */
+		if (preload_model(shared->config, model_space, shared->data, shared->journal, shared->cache,
+					&shared->stats[index], NULL, NULL)) continue;
+		order[shared->n_order++] = index;
+		shared->scheduled[index] = true;
+	}
+}
+
+int run_threaded( pltb_dataset_t *dataset, char *start_tree, pltb_config_t *config, model_space_t *model_space )
+{
+	if (config->attr_model_eval.numberOfThreads > 1) {
+		/* the pthreads version of PLL synchronizes its threads globally */
+		printf("Evaluation threads can't be combined with PLL threads. Quitting.\n");
+		return 1;
+	}
+
+	FILE *out = DEBUG_PROCESS_STATISTICS_OPEN_OUTPUT;
+	unsigned count     = model_space->matrix_count;
+	unsigned n_threads = config->eval_threads < count ? config->eval_threads : count;
+	TIME_STRUCT_INIT(phase);
+
+	pllAlignmentData *data = dataset->data;
+
+	/* journal & cache, the models found are left out of the schedule (@see schedule_models) */
+	uint64_t alignment_fingerprint = dataset->fingerprint;
+	uint64_t config_fingerprint    = fingerprint_config(config);
+	pltb_cache_t   cache;
+	pltb_journal_t journal;
+	if ((config->cache_dir != NULL && init_cache(&cache, config->cache_dir,
+				alignment_fingerprint, config_fingerprint, model_space) != 0)
+			|| (config->journal_file != NULL && open_journal(&journal, config->journal_file,
+				alignment_fingerprint, config_fingerprint, model_space) != 0)) {
+		return 1;
+	}
+
+	pltb_model_stat_t stats    [count];
+	bool              evaluated[count];
+	bool              scheduled[count];
+	unsigned          order    [count];
+	memset(evaluated, 0, sizeof(evaluated));
+
+	shared_state_t shared;
+	shared.model_space = model_space;
+	shared.data        = data;
+	shared.config      = config;
+	shared.order       = order;
+	shared.next        = 0;
+	shared.refine      = false;
+	shared.stats       = stats;
+	shared.evaluated   = evaluated;
+	shared.scheduled   = scheduled;
+	shared.warm_length = warm_start_length(data->sequenceCount);
+	shared.warm_states = NULL;
+	shared.journal     = config->journal_file != NULL ? &journal : NULL;
+	shared.cache       = config->cache_dir != NULL ? &cache : NULL;
+	pthread_mutex_init(&shared.journal_mutex, NULL);
+	pthread_mutex_init(&shared.warm_mutex, NULL);
+	pthread_cond_init(&shared.warm_cond, NULL);
+
+	if (config->warm_start) {
+		shared.warm_states = malloc(sizeof(double) * shared.warm_length * count);
+	}
+	pltb_cost_model_t cost_model;
+	init_cost_model(&cost_model, data, config);
+
+	/* all models in one go or the frontiers of a greedy climb one after another */
+	unsigned     all_models[count];
+	pltb_climb_t climb;
+	for (unsigned i = 0; i < count; i++) {
+		all_models[i] = i;
+	}
+	if (config->greedy_climb) {
+		init_climb(&climb, model_space);
+		/* the models left out don't add to the summary */
+		memset(stats, 0, sizeof(stats));
+	}
+
+	/* committing the partitions modifies the alignment: set up the contexts one after another */
+	eval_thread_t threads[n_threads];
+	for (unsigned t = 0; t < n_threads; t++) {
+		PHASE_START(phase);
+		init_eval_context(&threads[t].context, &config->attr_model_eval, data, config->base_freq_kind, config->rate_het, start_tree);
+		PHASE_END(config->profile, PHASE_SETUP, phase);
+		/* own copy, set_model changes the current model */
+		threads[t].model_space = *model_space;
+		threads[t].shared      = &shared;
+		init_profile(&threads[t].profile);
+	}
+	do {
+		if (config->greedy_climb) {
+			schedule_models(&shared, model_space, climb.frontier, climb.n_frontier, &cost_model);
+		} else {
+			schedule_models(&shared, model_space, all_models, count, &cost_model);
+		}
+		for (unsigned t = 0; t < n_threads; t++) {
+			pthread_create(&threads[t].thread, NULL, &run_eval_thread, &threads[t]);
+		}
+		for (unsigned t = 0; t < n_threads; t++) {
+			pthread_join(threads[t].thread, NULL);
+		}
+	} while (config->greedy_climb && advance_climb(&climb, stats));
+
+	/* screening: one more run re-optimizing the contenders at full precision */
+	bool    *screened = config->greedy_climb ? climb.evaluated : NULL;
+	unsigned contenders[count];
+	unsigned n_contenders = 0;
+	if (config->screen_epsilon > 0) {
+		n_contenders = select_contenders(model_space, stats, screened, config->screen_margin, contenders);
+		memcpy(order, contenders, sizeof(unsigned) * n_contenders);
+		shared.next    = 0;
+		shared.n_order = n_contenders;
+		shared.refine  = true;
+		for (unsigned t = 0; t < n_threads; t++) {
+			pthread_create(&threads[t].thread, NULL, &run_eval_thread, &threads[t]);
+		}
+		for (unsigned t = 0; t < n_threads; t++) {
+			pthread_join(threads[t].thread, NULL);
+		}
+	}
+	for (unsigned t = 0; t < n_threads; t++) {
+		destroy_eval_context(&threads[t].context);
+		merge_profile(config->profile, &threads[t].profile);
+	}
+	free(shared.warm_states);
+	pthread_mutex_destroy(&shared.journal_mutex);
+	pthread_mutex_destroy(&shared.warm_mutex);
+	pthread_cond_destroy(&shared.warm_cond);
+	if (shared.journal != NULL) {
+		close_journal(&journal);
+	}
+
+	/* merge in model order, just like the sequential version */
+	pltb_result_t result;
+	collect_result(model_space, stats, screened, &result);
+	fprint_eval_header(out, config);
+	report_eval_results(out, config, model_space, stats, true, &result,
+	                    config->greedy_climb ? &climb : NULL, contenders, n_contenders);
+	if (config->greedy_climb) {
+		destroy_climb(&climb);
+	}
+	DEBUG_PROCESS_STATISTICS_CLOSE_OUTPUT(out);
+
+	evaluate_result(model_space, &result, data, config, start_tree);
+	return 0;
+}
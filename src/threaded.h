@@ -0,0 +1,32 @@
+/**
+ * This file is part of PLTB.
+ * Copyright (C) 2015 Michael Hoff, Stefan Orf and Benedikt Riehm
+ *
+ * PLTB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PLTB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PLTB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef THREADED_H
+#define THREADED_H
+
+#include "pltb.h"
+#include "models.h"
+
+/**
+ * Evaluates config->eval_threads models concurrently within this process.
+ * Each thread owns an evaluation context, the alignment is shared.
+ * @param dataset The MSA shared by the configurations of the dataset
+ * @param start_tree The starting tree of the configuration (@see pltb_dataset_t)
+ */
+int run_threaded( pltb_dataset_t *dataset, char *start_tree, pltb_config_t *config, model_space_t *model_space );
+
+#endif